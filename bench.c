@@ -0,0 +1,312 @@
+/* ========================================================================== */
+/* Microbenchmarks of the GA kernels. Each kernel is run on a population of   */
+/* random members in a single process, without any communication, and timed   */
+/* over several repetitions, reporting the time per operation and throughput. */
+/*                                                                            */
+/* Usage: bench [-r REPS] [KERNEL...]                                         */
+/* Only the kernels whose names start with one of the given KERNELs are run.  */
+/* ========================================================================== */
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "config.h"
+#include "fitness.h"
+#include "ga.h"
+#include "init.h"
+#include "mt_mpi.h"
+#include "shapes.h"
+#include "types.h"
+
+#define BENCH_REPS          10      // Default number of timed repetitions
+#define BENCH_MIN_TIME      0.05    // Minimum length of a repetition (s)
+#define BENCH_POP_SIZE      320     // Members of each benchmark population
+#define BENCH_SHAPES        1024    // Obstacles of each shape_hits case
+
+
+/* -------------------------------------------------------------------------- */
+/* A benchmark case                                                           */
+/* name         : Name of the kernel, and its variant if any                  */
+/* run          : Runs the kernel iters times on subpop; returns a value that */
+/*                  depends on the results, so they are not optimized away    */
+/* subpop       : The population the kernel runs on                           */
+/* ops          : Number of operations per iteration                          */
+/* -------------------------------------------------------------------------- */
+typedef struct {
+    char        name[32];
+    long        (*run)(deme*, long);
+    deme        *subpop;
+    int         ops;
+} bench_case;
+
+static volatile long sink;
+static mt_state rng;     // The stream shared by all benchmark demes
+
+deme    *make_deme(int, int);
+deme    *make_shapes(int);
+void    run_case(bench_case*, int);
+double  now(void);
+
+
+static long run_fitness(deme *subpop, long iters) {
+    long i;
+    for (i = 0; i < iters; i++) fitness(subpop);
+    return subpop->fit_max;
+}
+
+static long run_collision(deme *subpop, long iters) {
+    long i, n = 0;
+    object *obj = subpop->objs[0];
+    for (i = 0; i < iters; i++)
+        n += collision(subpop->s, &subpop->t[i & 15], obj);
+    return n;
+}
+
+static long run_shape_hits(deme *subpop, long iters) {
+    long i, n = 0;
+    for (i = 0; i < iters; i++)
+        n += shape_hits(subpop->shapes, subpop->s, &subpop->t[i & 15]);
+    return n;
+}
+
+static long run_make_path(deme *subpop, long iters) {
+    long i, n = 0;
+    point **path;
+    for (i = 0; i < iters; i++) {
+        path = make_path(subpop, subpop->old_pop[i % subpop->pop_size]->chr);
+        n += path[1]->x;
+        free_path(path);
+    }
+    return n;
+}
+
+static long run_bin_to_decimal(deme *subpop, long iters) {
+    long i, n = 0;
+    char *chr = subpop->old_pop[0]->chr;
+    int size = subpop->cfg.coord_size;
+    for (i = 0; i < iters; i++)
+        n += binToDecimal(chr, (i & 15) * size, (i & 15) * size + size - 1);
+    return n;
+}
+
+static long run_selection(deme *subpop, long iters) {
+    long i, n = 0;
+    for (i = 0; i < iters; i++) n += selection(subpop);
+    return n;
+}
+
+static long run_crossover(deme *subpop, long iters) {
+    long i;
+    for (i = 0; i < iters; i++) crossover(subpop);
+    return subpop->new_pop[0]->chr[0];
+}
+
+static long run_mutation(deme *subpop, long iters) {
+    long i;
+    for (i = 0; i < iters; i++) mutation(subpop);
+    return subpop->new_pop[0]->chr[0];
+}
+
+static long run_mt_rand_32(deme *subpop, long iters) {
+    long i, n = 0;
+    for (i = 0; i < iters; i++) n += mt_rand_32(&rng);
+    return n;
+}
+
+
+int main(int argc, char *argv[]) {
+    int i, j, run, reps = BENCH_REPS, n_cases = 0, first = 1;
+    int n_objs[] = {0, 16, 128, 1024};
+    deme *simple, *shpath;
+    char *kinds[] = {"boxes", "capsules", "meshes"};
+    bench_case cases[24];
+
+    MPI_Init(&argc, &argv);
+    if (argc >= 3 && strcmp(argv[1], "-r") == 0) {
+        reps = atoi(argv[2]);
+        first = 3;
+    }
+    if (reps < 1) {
+        printf("Usage: bench [-r REPS] [KERNEL...]\n");
+        exit(-1);
+    }
+    mt_init(&rng, 0, DEFAULT_RAND_SEED);
+
+    simple = make_deme(FF_SIMPLE, 0);
+    shpath = make_deme(FF_SHPATH, 16);
+    cases[n_cases++] = (bench_case) {"fitness_simple", run_fitness, simple,
+        simple->pop_size};
+    for (i = 0; i < sizeof(n_objs) / sizeof(n_objs[0]); i++) {
+        cases[n_cases] = (bench_case) {"", run_fitness,
+            make_deme(FF_SHPATH, n_objs[i]), BENCH_POP_SIZE};
+        sprintf(cases[n_cases++].name, "fitness_shpath/%i", n_objs[i]);
+    }
+    cases[n_cases++] = (bench_case) {"collision", run_collision, shpath, 1};
+    for (i = 0; i < 3; i++) {
+        cases[n_cases] = (bench_case) {"", run_shape_hits, make_shapes(i),
+            BENCH_SHAPES};
+        sprintf(cases[n_cases++].name, "shape_hits/%s", kinds[i]);
+    }
+    cases[n_cases++] = (bench_case) {"make_path", run_make_path, shpath, 1};
+    cases[n_cases++] = (bench_case) {"binToDecimal", run_bin_to_decimal,
+        shpath, 1};
+    cases[n_cases++] = (bench_case) {"selection", run_selection, shpath, 1};
+    cases[n_cases++] = (bench_case) {"crossover/simple", run_crossover,
+        simple, simple->pop_size};
+    cases[n_cases++] = (bench_case) {"crossover/shpath", run_crossover,
+        shpath, shpath->pop_size};
+    cases[n_cases++] = (bench_case) {"mutation/simple", run_mutation,
+        simple, simple->pop_size};
+    cases[n_cases++] = (bench_case) {"mutation/shpath", run_mutation,
+        shpath, shpath->pop_size};
+    cases[n_cases++] = (bench_case) {"mt_rand_32", run_mt_rand_32, shpath, 1};
+
+    printf("%-22s %10s %10s %10s %8s %14s\n", "kernel", "ns/op", "min",
+        "max", "stddev", "ops/s");
+    for (i = 0; i < n_cases; i++) {
+        run = (first == argc);
+        for (j = first; j < argc; j++)
+            if (strncmp(cases[i].name, argv[j], strlen(argv[j])) == 0) run = 1;
+        if (run) run_case(&cases[i], reps);
+    }
+
+    MPI_Finalize();
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Create a population of random members, with n_objs random obstacles for    */
+/* the shortest path fitness function, and evaluate it once                   */
+/* -------------------------------------------------------------------------- */
+deme *make_deme(int ff_type, int n_objs) {
+    int i, j;
+    int stride;
+    char *pool;
+    deme *subpop = (deme*) malloc(sizeof(deme));
+
+    memset(subpop, 0, sizeof(deme));
+    subpop->comm = MPI_COMM_WORLD;
+    subpop->rng = &rng;
+    default_settings(&subpop->cfg);
+    subpop->ff_type = ff_type;
+    subpop->pop_size = BENCH_POP_SIZE;
+    if (ff_type == FF_SIMPLE) subpop->chr_size = CHR_SIZE_SIMPLE;
+    else subpop->chr_size = subpop->cfg.coord_size * 3 * subpop->cfg.n_points;
+    subpop->chr_max = subpop->chr_size;
+
+    // Lay out members as alloc_population does, without shared memory
+    stride = subpop->chr_size + 1;
+    pool = (char*) malloc(2 * subpop->pop_size * stride);
+    subpop->old_pop = (org**) malloc(sizeof(org*) * subpop->pop_size);
+    subpop->new_pop = (org**) malloc(sizeof(org*) * subpop->pop_size);
+    for (i = 0; i < subpop->pop_size; i++) {
+        subpop->old_pop[i] = (org*) malloc(sizeof(org));
+        subpop->new_pop[i] = (org*) malloc(sizeof(org));
+        subpop->old_pop[i]->chr = pool + i*stride;
+        subpop->new_pop[i]->chr = pool + (subpop->pop_size + i)*stride;
+        for (j = 0; j < subpop->chr_size; j++) {
+            subpop->old_pop[i]->chr[j] = mt_rand_bit(&rng);
+            subpop->new_pop[i]->chr[j] = mt_rand_bit(&rng);
+        }
+    }
+
+    // Start at the origin; the extra end points are used by run_collision
+    subpop->s = (point*) calloc(1, sizeof(point));
+    subpop->t = (point*) malloc(sizeof(point) * 16);
+    for (i = 0; i < 16; i++) {
+        subpop->t[i].x = mt_rand_int(2*SP_BOUND, &rng) - SP_BOUND;
+        subpop->t[i].y = mt_rand_int(2*SP_BOUND, &rng) - SP_BOUND;
+        subpop->t[i].z = mt_rand_int(2*SP_BOUND, &rng) - SP_BOUND;
+    }
+    subpop->n_objs = (n_objs > 0) ? n_objs : 1;
+    alloc_objects(subpop);
+    for (i = 0; i < subpop->n_objs; i++) {
+        subpop->objs[i]->center->x = mt_rand_int(2*SP_BOUND, &rng) - SP_BOUND;
+        subpop->objs[i]->center->y = mt_rand_int(2*SP_BOUND, &rng) - SP_BOUND;
+        subpop->objs[i]->center->z = mt_rand_int(2*SP_BOUND, &rng) - SP_BOUND;
+        subpop->objs[i]->radius = 1 + mt_rand_int(SP_BOUND/8, &rng);
+    }
+    subpop->n_objs = n_objs;
+
+    select_kernel(subpop);
+    fitness(subpop);
+    reproduction(subpop);
+    return subpop;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Create a shortest path population whose scene has BENCH_SHAPES random      */
+/* obstacles of one kind and no spheres. Mesh triangles are split into meshes */
+/* of 16, each spread over the whole space so that its bounds never cull it.  */
+/* kind          : SHAPE_BOXES, SHAPE_CAPSULES or SHAPE_MESHES                */
+/* -------------------------------------------------------------------------- */
+deme *make_shapes(int kind) {
+    int i, n[SHAPE_KINDS] = {0}, *recs;
+    deme *subpop = make_deme(FF_SHPATH, 0);
+
+    if (kind == SHAPE_MESHES) {
+        n[SHAPE_MESHES] = BENCH_SHAPES / 16;
+        n[SHAPE_TRIS] = BENCH_SHAPES;
+    }
+    else n[kind] = BENCH_SHAPES;
+    recs = (int*) malloc(sizeof(int) * shape_ints(n));
+
+    for (i = 0; i < shape_ints(n); i++)
+        recs[i] = mt_rand_int(2*SP_BOUND, &rng) - SP_BOUND;
+    // Only one kind is present, so its records start the array
+    for (i = 0; i < n[SHAPE_CAPSULES]; i++)
+        recs[7*i+6] = 1 + mt_rand_int(SP_BOUND/8, &rng);
+    for (i = 0; i < n[SHAPE_MESHES]; i++) recs[i] = 16;
+
+    subpop->shapes = shapes_create(n, recs);
+    return subpop;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Time a benchmark case and print its results. The number of iterations is   */
+/* doubled until one repetition takes at least BENCH_MIN_TIME, then reps      */
+/* repetitions of that many iterations are timed.                             */
+/* -------------------------------------------------------------------------- */
+void run_case(bench_case *bc, int reps) {
+    int i;
+    long iters = 1;
+    double start, t, sum = 0, sum_sq = 0, t_min = INFINITY, t_max = 0;
+    double mean, stddev;
+
+    for (;;) {
+        start = now();
+        sink += bc->run(bc->subpop, iters);
+        if (now() - start >= BENCH_MIN_TIME) break;
+        iters *= 2;
+    }
+
+    for (i = 0; i < reps; i++) {
+        start = now();
+        sink += bc->run(bc->subpop, iters);
+        t = (now() - start) * 1e9 / ((double) iters * bc->ops);
+        sum += t;
+        sum_sq += t*t;
+        if (t < t_min) t_min = t;
+        if (t > t_max) t_max = t;
+    }
+
+    mean = sum / reps;
+    stddev = sqrt(fmax(sum_sq / reps - mean*mean, 0));
+    printf("%-22s %10.2f %10.2f %10.2f %8.2f %14.0f\n", bc->name, mean,
+        t_min, t_max, stddev, 1e9 / mean);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Current time in seconds from a monotonic clock                             */
+/* -------------------------------------------------------------------------- */
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
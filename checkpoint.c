@@ -0,0 +1,266 @@
+/* ========================================================================== */
+/* Parallel checkpoint and restart. Every CKPT_RATE generations, the full     */
+/* state of each sub-population is written collectively with MPI-IO to one    */
+/* shared file, with each process writing a fixed-size record at an offset    */
+/* given by its rank. Writes are non-blocking, so the GA keeps running while  */
+/* a checkpoint is being written. Each checkpoint is written to <file>.tmp    */
+/* and only renamed to <file> once complete, so a run killed mid-write still  */
+/* leaves the previous checkpoint intact.                                     */
+/* ========================================================================== */
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "checkpoint.h"
+#include "config.h"
+#include "mt_mpi.h"
+#include "multires.h"
+#include "surrogate.h"
+#include "types.h"
+
+static void complete_checkpoint(deme*);
+
+#define CKPT_MAGIC      0x4741434b  // "GACK"
+
+
+/* -------------------------------------------------------------------------- */
+/* Header of each process's record in a checkpoint file. It is followed by    */
+/* the process's RNG state vector, then pop_size members, each stored as its  */
+/* fitness, both parent indices and the raw chromosome, then the state of the */
+/* process's surrogate model, if any.                                         */
+/* -------------------------------------------------------------------------- */
+typedef struct {
+    int         magic;
+    int         rank;
+    int         n_procs;
+    int         pop_size;
+    int         chr_size;
+    int         cur_gen;
+    int         fit_max;
+    int         fit_min;
+    int         fit_prev;
+    int         fit_novar;
+    int         stag_gens;
+    int         n_restarts;
+    int         shm_epoch;
+    int         mt_pos;
+    double      fit_tot;
+    double      fit_avg;
+    double      stag_best;
+    double      res_best;
+    double      n_evals;
+    double      elapsed;
+    int         tgt_gen[MAX_TARGETS];
+    double      tgt_time[MAX_TARGETS];
+} ckpt_header;
+
+
+/* -------------------------------------------------------------------------- */
+/* Write a checkpoint if one is due this generation. A run that has used up   */
+/* its time limit writes a final checkpoint, so that it can be resumed.       */
+/* -------------------------------------------------------------------------- */
+void checkpoint(deme *subpop) {
+    if (subpop->ckpt_file == NULL) return;
+    if ((subpop->ckpt_rate > 0 && subpop->cur_gen % subpop->ckpt_rate == 0)
+        || (subpop->complete && subpop->end_type == M_WALL_CLOCK))
+        write_checkpoint(subpop);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Find the size in bytes of each process's record in a checkpoint file. Each */
+/* member has room for the largest chromosome of the run, so that records     */
+/* stay in place as a multi-resolution run grows its chromosomes.             */
+/* -------------------------------------------------------------------------- */
+int ckpt_record_size(deme *subpop) {
+    int member = sizeof(double) + 2*sizeof(int) + subpop->chr_max;
+    return sizeof(ckpt_header) + N*sizeof(unsigned long)
+        + subpop->pop_size*member + surrogate_size(subpop);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Pack the state of this sub-population into a staging buffer and start a    */
+/* collective write of it to <file>.tmp. The previous checkpoint, if still    */
+/* in progress, is completed first.                                           */
+/* -------------------------------------------------------------------------- */
+void write_checkpoint(deme *subpop) {
+    int i, my_rank, n_procs;
+    int size = ckpt_record_size(subpop);
+    char tmp_file[strlen(subpop->ckpt_file) + 5];
+    ckpt_header hdr;
+    char *p;
+    my_rank = subpop->rank;
+    MPI_Comm_size(subpop->comm, &n_procs);
+
+    if (subpop->ckpt_buf == NULL) subpop->ckpt_buf = (char*) malloc(size);
+    else complete_checkpoint(subpop);
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = CKPT_MAGIC;
+    hdr.rank = my_rank;
+    hdr.n_procs = n_procs;
+    hdr.pop_size = subpop->pop_size;
+    hdr.chr_size = subpop->chr_size;
+    hdr.cur_gen = subpop->cur_gen;
+    hdr.fit_max = subpop->fit_max;
+    hdr.fit_min = subpop->fit_min;
+    hdr.fit_prev = subpop->fit_prev;
+    hdr.fit_novar = subpop->fit_novar;
+    hdr.stag_gens = subpop->stag_gens;
+    hdr.n_restarts = subpop->n_restarts;
+    hdr.shm_epoch = subpop->shm_epoch;
+    hdr.fit_tot = subpop->fit_tot;
+    hdr.fit_avg = subpop->fit_avg;
+    hdr.stag_best = subpop->stag_best;
+    hdr.res_best = subpop->res_best;
+    hdr.n_evals = subpop->n_evals;
+    hdr.elapsed = MPI_Wtime() - subpop->start_time;
+    memcpy(hdr.tgt_gen, subpop->tgt_gen, sizeof(hdr.tgt_gen));
+    memcpy(hdr.tgt_time, subpop->tgt_time, sizeof(hdr.tgt_time));
+
+    p = subpop->ckpt_buf + sizeof(hdr);
+    hdr.mt_pos = mt_get_state(subpop->rng, (unsigned long*) p);
+    memcpy(subpop->ckpt_buf, &hdr, sizeof(hdr));
+    p += N*sizeof(unsigned long);
+
+    for (i = 0; i < subpop->pop_size; i++) {
+        memcpy(p, &subpop->new_pop[i]->fitness, sizeof(double));
+        p += sizeof(double);
+        memcpy(p, &subpop->new_pop[i]->parent1, sizeof(int));
+        p += sizeof(int);
+        memcpy(p, &subpop->new_pop[i]->parent2, sizeof(int));
+        p += sizeof(int);
+        memcpy(p, subpop->new_pop[i]->chr, subpop->chr_size);
+        memset(p + subpop->chr_size, 0, subpop->chr_max - subpop->chr_size);
+        p += subpop->chr_max;
+    }
+    save_surrogate(subpop, p);
+
+    sprintf(tmp_file, "%s.tmp", subpop->ckpt_file);
+    MPI_File_open(subpop->comm, tmp_file, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+        MPI_INFO_NULL, &subpop->ckpt_fh);
+    MPI_File_iwrite_at_all(subpop->ckpt_fh, (MPI_Offset) my_rank*size,
+        subpop->ckpt_buf, size, MPI_CHAR, &subpop->ckpt_req);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Complete the checkpoint in progress. Once every process has closed         */
+/* <file>.tmp, process 0 renames it over <file>, which replaces the previous  */
+/* checkpoint in one step.                                                    */
+/* -------------------------------------------------------------------------- */
+static void complete_checkpoint(deme *subpop) {
+    char tmp_file[strlen(subpop->ckpt_file) + 5];
+
+    MPI_Wait(&subpop->ckpt_req, MPI_STATUS_IGNORE);
+    MPI_File_close(&subpop->ckpt_fh);
+    MPI_Barrier(subpop->comm);
+    if (subpop->rank == 0) {
+        sprintf(tmp_file, "%s.tmp", subpop->ckpt_file);
+        if (rename(tmp_file, subpop->ckpt_file) != 0)
+            fprintf(stderr, "Error: Could not rename %s to %s\n", tmp_file,
+                subpop->ckpt_file);
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Complete any checkpoint still in progress and release its staging buffer   */
+/* -------------------------------------------------------------------------- */
+void finish_checkpoint(deme *subpop) {
+    if (subpop->ckpt_buf == NULL) return;
+
+    complete_checkpoint(subpop);
+    free(subpop->ckpt_buf);
+    subpop->ckpt_buf = NULL;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Restore the state of this sub-population from a checkpoint file. The run   */
+/* must use the same parameters and number of processes as the one that       */
+/* wrote the file; it then continues exactly where that run left off.         */
+/* filename      : The checkpoint file to read                                */
+/* return        : 0 on success; non-zero if the file could not be read or    */
+/*                  does not match this run                                   */
+/* -------------------------------------------------------------------------- */
+int read_checkpoint(deme *subpop, char *filename) {
+    int i, err, my_rank, n_procs, bad, gens[2];
+    int size = ckpt_record_size(subpop);
+    char *buf = (char*) malloc(size);
+    char *p = buf + sizeof(ckpt_header);
+    ckpt_header hdr;
+    MPI_File fh;
+    my_rank = subpop->rank;
+    MPI_Comm_size(subpop->comm, &n_procs);
+
+    err = MPI_File_open(subpop->comm, filename, MPI_MODE_RDONLY,
+        MPI_INFO_NULL, &fh);
+    if (err != MPI_SUCCESS) {
+        if (my_rank == 0)
+            fprintf(stderr, "Error: Could not open checkpoint %s\n", filename);
+        free(buf);
+        return -1;
+    }
+    MPI_File_read_at_all(fh, (MPI_Offset) my_rank*size, buf, size, MPI_CHAR,
+        MPI_STATUS_IGNORE);
+    MPI_File_close(&fh);
+
+    memcpy(&hdr, buf, sizeof(hdr));
+    bad = (hdr.magic != CKPT_MAGIC || hdr.rank != my_rank
+        || hdr.n_procs != n_procs || hdr.pop_size != subpop->pop_size
+        || !set_resolution(subpop, hdr.chr_size));
+
+    // Every record must be from the same generation, or the demes' collective
+    // calls would no longer line up
+    gens[0] = -hdr.cur_gen;
+    gens[1] = hdr.cur_gen;
+    MPI_Allreduce(MPI_IN_PLACE, gens, 2, MPI_INT, MPI_MAX, subpop->comm);
+    if (bad) fprintf(stderr, "Error: Checkpoint %s does not match this run\n",
+        filename);
+    else if (-gens[0] != gens[1] && my_rank == 0)
+        fprintf(stderr, "Error: Checkpoint %s mixes generations %i to %i\n",
+            filename, -gens[0], gens[1]);
+    if (bad || -gens[0] != gens[1]) {
+        free(buf);
+        return -1;
+    }
+
+    subpop->cur_gen = hdr.cur_gen;
+    subpop->fit_max = hdr.fit_max;
+    subpop->fit_min = hdr.fit_min;
+    subpop->fit_prev = hdr.fit_prev;
+    subpop->fit_novar = hdr.fit_novar;
+    subpop->stag_gens = hdr.stag_gens;
+    subpop->n_restarts = hdr.n_restarts;
+    subpop->stag_best = hdr.stag_best;
+    subpop->shm_epoch = hdr.shm_epoch;
+    subpop->fit_tot = hdr.fit_tot;
+    subpop->fit_avg = hdr.fit_avg;
+    subpop->res_best = hdr.res_best;
+    subpop->n_evals = hdr.n_evals;
+    subpop->prior_time = hdr.elapsed;
+    memcpy(subpop->tgt_gen, hdr.tgt_gen, sizeof(hdr.tgt_gen));
+    memcpy(subpop->tgt_time, hdr.tgt_time, sizeof(hdr.tgt_time));
+    mt_set_state(subpop->rng, (unsigned long*) p, hdr.mt_pos);
+    p += N*sizeof(unsigned long);
+
+    for (i = 0; i < subpop->pop_size; i++) {
+        memcpy(&subpop->new_pop[i]->fitness, p, sizeof(double));
+        p += sizeof(double);
+        memcpy(&subpop->new_pop[i]->parent1, p, sizeof(int));
+        p += sizeof(int);
+        memcpy(&subpop->new_pop[i]->parent2, p, sizeof(int));
+        p += sizeof(int);
+        memcpy(subpop->new_pop[i]->chr, p, subpop->chr_size);
+        p += subpop->chr_max;
+    }
+    load_surrogate(subpop, p);
+
+    // As in the main loop, later generations use new_pop as old_pop
+    subpop->old_pop = subpop->new_pop;
+    free(buf);
+    return 0;
+}
+
@@ -0,0 +1,12 @@
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+#include "types.h"
+
+void    checkpoint(deme*);
+void    write_checkpoint(deme*);
+void    finish_checkpoint(deme*);
+int     read_checkpoint(deme*, char*);
+int     ckpt_record_size(deme*);
+
+#endif
+
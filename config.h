@@ -5,9 +5,37 @@
 #define PRNT_INFO                   1       // Report human-readable data
 #define PRNT_FITS                   1       // Report individual fitness
 #define BUFFER_SIZE                 64
+#define EXPORT_OBJS_MAX             64      // Export more as a binary file
+#define LOG_BUFFER_SIZE             1048576 // Bytes buffered by run log (-l)
+
+#define SHM_MIGRATION               1       // Migrate via shared memory on-node
+#define HIER_MIGRATION              0       // Two-level (node/leader) migration
+#define MIGRATION_RATE_LOCAL        1       // Gens between node exchanges
+#define MIGRATION_RATE_REMOTE       50      // Gens between leader exchanges
+
+#define CKPT_RATE                   500     // Gens between checkpoints (-c)
+#define MAX_TARGETS                 8       // Fitness targets timed per run
+#define TIME_RESERVE                0.02    // Part of time_limit kept for exit
+#define BATCH_GROUP_SIZE            1       // Processes per instance (-b)
+#define NUMA_ALLOC                  0       // Place deme memory on local node
+#define HUGE_PAGES                  0       // 1: transparent, 2: explicit
 
 #define CROSSOVER_RATE              0.8
 #define MUTATION_RATE               0.05
+#define SELECTION                   SEL_ROULETTE
+#define CROSSOVER                   XO_MIDPOINT
+#define TOURN_SIZE                  2       // Members per tournament
+
+#define GENOME                      GENOME_BINARY
+#define MUT_SIGMA                   32.0    // Std. dev. of integer mutation
+
+#define GENOME_BINARY               0
+#define GENOME_INT                  1
+#define SEL_ROULETTE                0
+#define SEL_TOURNAMENT              1
+#define XO_MIDPOINT                 0
+#define XO_ONE_POINT                1
+#define XO_UNIFORM                  2
 
 #define FF_SIMPLE                   0
 #define FF_SHPATH                   1
@@ -15,6 +43,7 @@
 #define M_MAX_FITNESS_THRESHHOLD    1
 #define M_AVG_FITNESS_THRESHHOLD    2
 #define M_LOCAL_CONVERGENCE         3
+#define M_WALL_CLOCK                4
 
 #define DEFAULT_RAND_SEED           42
 #define DEFAULT_FF_TYPE             FF_SIMPLE
@@ -25,6 +54,7 @@
 #define DEFAULT_F_THRESH_SHPATH     10000.0
 #define DEFAULT_CONV_GENS           20
 #define DEFAULT_CONV_VARIATION      100
+#define DEFAULT_TIME_LIMIT          3600.0
 
 #define CHR_SIZE_SIMPLE             32
 
@@ -34,3 +64,32 @@
 #define CHR_SIZE_SHPATH             COORD_SIZE*3*N_POINTS
 #define COLLISION_COST              100
 
+#define LS_TOP                      0       // Members refined by local search
+#define LS_PROBES                   128     // Local search probes per member
+#define LS_STEP                     64      // Initial local search step size
+
+#define SEED_LINE                   0.0     // Initial paths seeded as lines
+#define SEED_DETOUR                 0.0     // Initial paths seeded as detours
+#define SEED_JITTER                 64      // Max. jitter of seeded waypoints
+#define SEED_MARGIN                 1.1     // Radii from an obstacle's center
+                                            // that seeded waypoints are moved
+
+#define SURR_FRAC                   1.0     // Offspring evaluated after
+                                            // screening; 1 to disable
+#define SURR_K                      3       // Neighbors per surrogate estimate
+#define SURR_ARCHIVE                256     // Members kept by the surrogate
+
+#define N_POINTS_START              0       // Initial waypoints; 0 to disable
+#define RES_GENS                    25      // Generations between res. checks
+#define RES_IMPROVE                 0.001   // Relative gain below which paths
+                                            // are subdivided
+
+#define RESTART_GENS                0       // Stagnant gens before a deme is
+                                            // restarted; 0 to disable
+#define RESTART_ELITE               2       // Members kept by a restart
+#define RESTART_IMPROVE             0.001   // Relative gain that ends a
+                                            // deme's stagnation
+
+#define FUSED_PIPELINE              0       // Breed and evaluate offspring
+                                            // in one pass
+
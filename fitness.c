@@ -3,18 +3,130 @@
 /* ========================================================================= */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "config.h"
 #include "fitness.h"
+#include "ga.h"
+#include "shapes.h"
 #include "types.h"
 
+static inline void shpath_kernel(deme*, int, int, int)
+    __attribute__((always_inline));
+static inline double shpath_member(deme*, char*, int, int, int)
+    __attribute__((always_inline));
+static inline double simple_member(char*)
+    __attribute__((always_inline));
+static inline int must_evaluate(deme*, org**, int)
+    __attribute__((always_inline));
+static inline void fused_kernel(deme*, int, int, int)
+    __attribute__((always_inline));
+static void fused_simple(deme*);
+static void fused_shpath(deme*);
+static void fitness_shpath_int(deme*);
+static void fused_shpath_int(deme*);
+static inline void decode(char*, point*, point*, point*, int, int, int)
+    __attribute__((always_inline));
+
 
 /* ------------------------------------------------------------------------- */
-/* Call the appropriate fitness function                                     */
+/* Call the appropriate fitness function. Members flagged in skip keep the   */
+/* fitness predicted for them, and are not counted as evaluations.           */
 /* ------------------------------------------------------------------------- */
 void fitness(deme *subpop) {
-    if      (subpop->ff_type == FF_SIMPLE)  fitness_simple(subpop);
-    else if (subpop->ff_type == FF_SHPATH)  fitness_shpath(subpop);
+    subpop->fit_kernel(subpop);
+    subpop->n_evals += subpop->pop_size - subpop->n_skip;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Test if a member must be evaluated. A member flagged in skip keeps its    */
+/* predicted fitness, unless that would make it the most fit member; it is   */
+/* then evaluated after all, so that the member reported, migrated and       */
+/* tested against targets and thresholds as the best always has its true     */
+/* fitness.                                                                  */
+/* ------------------------------------------------------------------------- */
+static inline int must_evaluate(deme *subpop, org **pop, int i) {
+    if (subpop->skip == NULL || !subpop->skip[i]) return 1;
+    if (i != subpop->fit_max
+        && pop[i]->fitness <= pop[subpop->fit_max]->fitness) return 0;
+
+    subpop->skip[i] = 0;
+    subpop->n_skip--;
+    return 1;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Produce and evaluate all offspring of a generation in one pass, instead   */
+/* of separate reproduction, crossover, mutation and fitness passes; see     */
+/* fused_kernel.                                                             */
+/* ------------------------------------------------------------------------- */
+void fused_offspring(deme *subpop) {
+    subpop->fused_kernel(subpop);
+    subpop->n_evals += subpop->pop_size;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Specialized variants of the shortest path fitness function and the fused  */
+/* offspring pipeline, for common settings of n_points and coord_size. With  */
+/* these known at compile time, the decoding and path loops are unrolled and */
+/* need no runtime bounds.                                                   */
+/* ------------------------------------------------------------------------- */
+#define SHPATH_KERNEL(np, cs)                                                 \
+static void fitness_shpath_##np##_##cs(deme *subpop) {                        \
+    shpath_kernel(subpop, np, cs, GENOME_BINARY);                             \
+}                                                                             \
+static void fused_shpath_##np##_##cs(deme *subpop) {                          \
+    fused_kernel(subpop, np, cs, GENOME_BINARY);                              \
+}
+
+SHPATH_KERNEL(16, 12)
+SHPATH_KERNEL(32, 12)
+SHPATH_KERNEL(64, 12)
+SHPATH_KERNEL(32, 16)
+
+static const struct {
+    int         n_points;
+    int         coord_size;
+    void        (*kernel)(deme*);
+    void        (*fused)(deme*);
+} shpath_kernels[] = {
+    {16, 12, fitness_shpath_16_12, fused_shpath_16_12},
+    {32, 12, fitness_shpath_32_12, fused_shpath_32_12},
+    {64, 12, fitness_shpath_64_12, fused_shpath_64_12},
+    {32, 16, fitness_shpath_32_16, fused_shpath_32_16},
+};
+
+
+/* ------------------------------------------------------------------------- */
+/* Select the fitness function for this population's settings; the shortest  */
+/* path function uses a specialized variant, if there is one, or the one of  */
+/* the integer genome.                                                       */
+/* ------------------------------------------------------------------------- */
+void select_kernel(deme *subpop) {
+    int i, n = sizeof(shpath_kernels) / sizeof(shpath_kernels[0]);
+
+    if (subpop->ff_type == FF_SIMPLE) {
+        subpop->fit_kernel = fitness_simple;
+        subpop->fused_kernel = fused_simple;
+    }
+    else if (subpop->cfg.genome == GENOME_INT) {
+        subpop->fit_kernel = fitness_shpath_int;
+        subpop->fused_kernel = fused_shpath_int;
+    }
+    else {
+        subpop->fit_kernel = fitness_shpath;
+        subpop->fused_kernel = fused_shpath;
+        for (i = 0; i < n; i++) {
+            if (shpath_kernels[i].n_points == subpop->cfg.n_points
+                && shpath_kernels[i].coord_size == subpop->cfg.coord_size) {
+                subpop->fit_kernel = shpath_kernels[i].kernel;
+                subpop->fused_kernel = shpath_kernels[i].fused;
+            }
+        }
+    }
 }
 
 
@@ -24,7 +136,7 @@ void fitness(deme *subpop) {
 /* (maximum possible fitness of 130050 with 8-bit values)                    */
 /* ------------------------------------------------------------------------- */
 void fitness_simple(deme *subpop) {
-    int i, x, y, a, b;
+    int i;
     double fit;
     org** pop;
     if (subpop->fit_tot < 1) pop = subpop->old_pop;
@@ -35,13 +147,9 @@ void fitness_simple(deme *subpop) {
     subpop->fit_tot = 0.0;
 
     for (i = 0; i < subpop->pop_size; i++) {
-        x = binToDecimal(pop[i]->chr, 0, 7);
-        y = binToDecimal(pop[i]->chr, 8, 15);
-        a = binToDecimal(pop[i]->chr, 16, 23);
-        b = binToDecimal(pop[i]->chr, 24, 31);
-        fit = (y*y) + (x*x) + (a*a) + (b*b) - (2*x*y) - (2*a*b);
-        if (fit < 0) fit = 0;
-        pop[i]->fitness = fit;
+        if (must_evaluate(subpop, pop, i))
+            pop[i]->fitness = simple_member(pop[i]->chr);
+        fit = pop[i]->fitness;
         subpop->fit_tot += fit;
         if (fit > pop[subpop->fit_max]->fitness) subpop->fit_max = i;
         if (fit < pop[subpop->fit_min]->fitness) subpop->fit_min = i;
@@ -52,53 +160,169 @@ void fitness_simple(deme *subpop) {
 }
 
 
+/* ------------------------------------------------------------------------- */
+/* Evaluate one chromosome with the simple fitness function                  */
+/* ------------------------------------------------------------------------- */
+static inline double simple_member(char *chr) {
+    int x, y, a, b;
+    double fit;
+
+    x = binToDecimal(chr, 0, 7);
+    y = binToDecimal(chr, 8, 15);
+    a = binToDecimal(chr, 16, 23);
+    b = binToDecimal(chr, 24, 31);
+    fit = (y*y) + (x*x) + (a*a) + (b*b) - (2*x*y) - (2*a*b);
+    if (fit < 0) fit = 0;
+    return fit;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Fused offspring pipelines of the simple and shortest path functions       */
+/* ------------------------------------------------------------------------- */
+static void fused_simple(deme *subpop) {
+    fused_kernel(subpop, 0, 0, GENOME_BINARY);
+}
+
+static void fused_shpath(deme *subpop) {
+    fused_kernel(subpop, subpop->cfg.n_points, subpop->cfg.coord_size,
+        subpop->cfg.genome);
+}
+
+static void fused_shpath_int(deme *subpop) {
+    fused_kernel(subpop, subpop->cfg.n_points, 0, GENOME_INT);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Body of the fused offspring pipeline. Each pair of offspring is bred from */
+/* old_pop and evaluated while its chromosomes are still in cache, and the   */
+/* fitness stats of the new population come out of the same pass. Since      */
+/* selection still needs the stats of the parents, they are only replaced    */
+/* at the end.                                                               */
+/* After the first generation, old_pop and new_pop are the same array, so    */
+/* the offspring are bred into the members of the other half of the block    */
+/* of member pointers (see alloc_population), and then swapped into new_pop. */
+/* ------------------------------------------------------------------------- */
+static inline void fused_kernel(deme *subpop, int n_points, int coord_size,
+        int genome) {
+    int i, j, n = subpop->pop_size, fit_max = 0, fit_min = 0;
+    double fit, fit_tot = 0.0;
+    org **pop = subpop->new_pop, **kids = pop, tmp;
+
+    if (subpop->old_pop == subpop->new_pop) kids = pop - n;
+
+    for (i = 0; i < n; i += 2) {
+        breed_pair(subpop, kids[i], (i+1 < n) ? kids[i+1] : NULL);
+        for (j = i; j < i+2 && j < n; j++) {
+            if (subpop->ff_type == FF_SIMPLE) fit = simple_member(kids[j]->chr);
+            else fit = shpath_member(subpop, kids[j]->chr, n_points,
+                coord_size, genome);
+            kids[j]->fitness = fit;
+            fit_tot += fit;
+            if (fit > kids[fit_max]->fitness) fit_max = j;
+            if (fit < kids[fit_min]->fitness) fit_min = j;
+        }
+    }
+
+    if (kids != pop) {
+        for (i = 0; i < n; i++) {
+            tmp = *pop[i];
+            *pop[i] = *kids[i];
+            *kids[i] = tmp;
+        }
+    }
+
+    subpop->fit_prev = subpop->fit_avg;
+    subpop->fit_tot = fit_tot;
+    subpop->fit_avg = fit_tot / n;
+    subpop->fit_max = fit_max;
+    subpop->fit_min = fit_min;
+}
+
+
 /* ------------------------------------------------------------------------- */
 /* Evaluates each population member as a 3D path.                            */
 /* Fitness is determined by path length and number of object collisions.     */
 /* ------------------------------------------------------------------------- */
 void fitness_shpath(deme *subpop) {
-    int i, j, k, colls;
-    double cost, fit, dist;
-    double max_cost = SP_BOUND*40;
+    shpath_kernel(subpop, subpop->cfg.n_points, subpop->cfg.coord_size,
+        subpop->cfg.genome);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* The shortest path fitness function for the integer genome, whose members  */
+/* are read in place without any decoding                                    */
+/* ------------------------------------------------------------------------- */
+static void fitness_shpath_int(deme *subpop) {
+    shpath_kernel(subpop, subpop->cfg.n_points, 0, GENOME_INT);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Body of the shortest path fitness function, for a given number of         */
+/* waypoints, coordinate size and genome                                     */
+/* ------------------------------------------------------------------------- */
+static inline void shpath_kernel(deme *subpop, int n_points, int coord_size,
+        int genome) {
+    int i;
+    double fit;
 
     org** pop;
     if (subpop->fit_tot < 1) pop = subpop->old_pop;
     else                     pop = subpop->new_pop;
-    point **path;
 
     subpop->fit_prev = subpop->fit_avg;
     subpop->fit_avg = 0.0;
     subpop->fit_tot = 0.0;
 
     for (i = 0; i < subpop->pop_size; i++) {
-        // Construct and find length of path
-        path = make_path(pop[i]->chr, subpop->s, subpop->t);
-        dist = 0;
-        for (j = 0; j < N_POINTS+1; j++)
-            dist += pt_dist(path[j], path[j+1]);
-
-        // Detect collisions between path and obstacles
-        colls = 0;
-        for (j = 0; j < N_POINTS+1; j++) {
-            for (k = 0; k < subpop->n_objs; k++) {
-                if (collision(path[j], path[j+1], subpop->objs[k])) colls++;
-            }
-        }
-
-        // Calculate fitness
-        cost = dist + (colls*COLLISION_COST);
-        fit = max_cost - cost;
-        if (fit < 0) fit = 1;
-        pop[i]->fitness = fit;
+        if (must_evaluate(subpop, pop, i))
+            pop[i]->fitness = shpath_member(subpop, pop[i]->chr, n_points,
+                coord_size, genome);
+        fit = pop[i]->fitness;
         subpop->fit_tot += fit;
         if (fit > pop[subpop->fit_max]->fitness) subpop->fit_max = i;
         if (fit < pop[subpop->fit_min]->fitness) subpop->fit_min = i;
-
-        free_path(path);
     }
 
     subpop->fit_avg = subpop->fit_tot / subpop->pop_size;
-    //printf("FIT DONE\n");
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Evaluate one chromosome as a 3D path, for a given number of waypoints,    */
+/* coordinate size and genome                                                */
+/* ------------------------------------------------------------------------- */
+static inline double shpath_member(deme *subpop, char *chr, int n_points,
+        int coord_size, int genome) {
+    int j, k, colls;
+    double cost, fit, dist;
+    double max_cost = SP_BOUND*40;
+    point path[n_points+2];
+
+    // Construct and find length of path
+    decode(chr, subpop->s, subpop->t, path, n_points, coord_size, genome);
+    dist = 0;
+    for (j = 0; j < n_points+1; j++)
+        dist += pt_dist(&path[j], &path[j+1]);
+
+    // Detect collisions between path and obstacles
+    colls = 0;
+    for (j = 0; j < n_points+1; j++) {
+        for (k = 0; k < subpop->n_objs; k++) {
+            if (collision(&path[j], &path[j+1], subpop->objs[k])) colls++;
+        }
+        if (subpop->shapes != NULL)
+            colls += shape_hits(subpop->shapes, &path[j], &path[j+1]);
+    }
+
+    // Calculate fitness
+    cost = dist + (colls*subpop->cfg.coll_cost);
+    fit = max_cost - cost;
+    if (fit < 0) fit = 1;
+    return fit;
 }
 
 
@@ -146,6 +370,33 @@ int collision(point *A, point *B, object *obj) {
 }
 
 
+/* ------------------------------------------------------------------------- */
+/* Find the number of chromosome bytes per waypoint of this population       */
+/* ------------------------------------------------------------------------- */
+int point_size(deme *subpop) {
+    if (subpop->cfg.genome == GENOME_INT) return 3 * sizeof(int);
+    return 3 * subpop->cfg.coord_size;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Find the largest waypoint coordinate a chromosome can encode              */
+/* ------------------------------------------------------------------------- */
+int coord_bound(deme *subpop) {
+    int bound = (1 << (subpop->cfg.coord_size - 1)) - 1;
+    return (bound > SP_BOUND) ? SP_BOUND : bound;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Round a coordinate to the nearest integer within +/- bound                */
+/* ------------------------------------------------------------------------- */
+int clamp_coord(double c, int bound) {
+    long r = lround(c);
+    return (r > bound) ? bound : (r < -bound) ? -bound : (int) r;
+}
+
+
 /* ------------------------------------------------------------------------- */
 /* Test if a point is in a valid location; e.g., within the defined bounds   */
 /* ------------------------------------------------------------------------- */
@@ -168,48 +419,105 @@ void pt_copy(point *dest, point *src) {
 
 
 /* ------------------------------------------------------------------------- */
-/* Construct a path from a set of points represented by a binary string      */
+/* Decode a path from a set of points represented by a binary string.        */
+/* Each coordinate is stored in sign-magnitude form, with the sign first.    */
 /* chr          : A binary string representing a list of points. Each        */
-/*                coordinate is COOR_SIZE bits long.                         */
+/*                coordinate is coord_size bits long.                        */
 /* s            : The start point of the path                                */
 /* t            : The end point of the path                                  */
+/* path         : Receives the n_points+2 points of the path, from s to t    */
+/* With GENOME_INT, chr instead holds the waypoints' coordinates as ints,    */
+/* laid out as the arrays x[n_points], y[n_points] and z[n_points], which    */
+/* are copied as they are.                                                   */
 /* ------------------------------------------------------------------------- */
-point **make_path(char *chr, point *s, point *t) {
-    int i, x, y, z, disp, sign_x, sign_y, sign_z;
+static inline void decode(char *chr, point *s, point *t, point *path,
+                          int n_points, int coord_size, int genome) {
+    int i, c, b, val, coord[3];
+    int w[genome == GENOME_INT ? 3*n_points : 1];
+
+    pt_copy(&path[0], s);
+    if (genome == GENOME_INT) {
+        memcpy(w, chr, sizeof(int) * 3*n_points);
+        for (i = 1; i < n_points+1; i++) {
+            path[i].x = w[i-1];
+            path[i].y = w[n_points + i-1];
+            path[i].z = w[2*n_points + i-1];
+        }
+    }
+    else for (i = 1; i < n_points+1; i++) {
+        for (c = 0; c < 3; c++, chr += coord_size) {
+            for (b = 1, val = 0; b < coord_size; b++)
+                val = 2*val + (chr[b] - '0');
+            coord[c] = (chr[0] == '1') ? -val : val;
+        }
+        path[i].x = coord[0];
+        path[i].y = coord[1];
+        path[i].z = coord[2];
+    }
+    pt_copy(&path[n_points+1], t);
+}
 
-    // Define relative start and end points of coordinate values
-    unsigned int x_begin = 0,           x_end = COORD_SIZE-1;
-    unsigned int y_begin = x_end+1,     y_end = (2*(COORD_SIZE))-1;
-    unsigned int z_begin = y_end+1,     z_end = (3*(COORD_SIZE))-1;
 
-    point **path = (point**) malloc(sizeof(point*) * (N_POINTS+2));
-    for(i = 0, disp = 0; i < N_POINTS+2; i++, disp+=(z_end+1))
-        path[i] = (point*) malloc(sizeof(point));
+/* ------------------------------------------------------------------------- */
+/* Decode a chromosome of this population into a path of n_points+2 points   */
+/* ------------------------------------------------------------------------- */
+void decode_path(deme *subpop, char *chr, point *path) {
+    decode(chr, subpop->s, subpop->t, path, subpop->cfg.n_points,
+        subpop->cfg.coord_size, subpop->cfg.genome);
+}
 
-    // Convert the string into a series of (x,y,z) coodinates
-    pt_copy(path[0], s);
-    for(i = 1, disp = 0; i < N_POINTS+1; i++, disp+=(z_end+1)) {
-        sign_x = binToDecimal(chr, disp+x_begin, disp+x_begin);
-        sign_y = binToDecimal(chr, disp+y_begin, disp+y_begin);
-        sign_z = binToDecimal(chr, disp+z_begin, disp+z_begin);
 
-        x = binToDecimal(chr, disp+x_begin+1, disp+x_end);
-        y = binToDecimal(chr, disp+y_begin+1, disp+y_end);
-        z = binToDecimal(chr, disp+z_begin+1, disp+z_end);
+/* ------------------------------------------------------------------------- */
+/* Encode the waypoints of a path into a chromosome of this population; the  */
+/* inverse of decode_path. Coordinates must fit in coord_size-1 bits.        */
+/* path         : The n_points+2 points of the path, from s to t             */
+/* chr          : Receives the encoded waypoints                             */
+/* ------------------------------------------------------------------------- */
+void encode_path(deme *subpop, point *path, char *chr) {
+    int i, c, b, val, coord[3];
+    int n = subpop->cfg.n_points, coord_size = subpop->cfg.coord_size;
+    int w[3*n];
+
+    if (subpop->cfg.genome == GENOME_INT) {
+        for (i = 1; i < n+1; i++) {
+            w[i-1] = path[i].x;
+            w[n + i-1] = path[i].y;
+            w[2*n + i-1] = path[i].z;
+        }
+        memcpy(chr, w, sizeof(w));
+        return;
+    }
 
-        if (sign_x) path[i]->x = x*-1;  else path[i]->x = x;
-        if (sign_y) path[i]->y = y*-1;  else path[i]->y = y;
-        if (sign_z) path[i]->z = z*-1;  else path[i]->z = z;
+    for (i = 1; i < subpop->cfg.n_points+1; i++) {
+        coord[0] = path[i].x;
+        coord[1] = path[i].y;
+        coord[2] = path[i].z;
+        for (c = 0; c < 3; c++, chr += coord_size) {
+            chr[0] = (coord[c] < 0) ? '1' : '0';
+            val = abs(coord[c]);
+            for (b = coord_size-1; b > 0; b--, val >>= 1)
+                chr[b] = '0' + (val & 1);
+        }
     }
-    pt_copy(path[N_POINTS+1], t);
+}
 
+
+/* ------------------------------------------------------------------------- */
+/* Construct a path from a chromosome of this population, as an array of     */
+/* n_points+2 pointers to points. Free with free_path.                       */
+/* ------------------------------------------------------------------------- */
+point **make_path(deme *subpop, char *chr) {
+    int i, n = subpop->cfg.n_points + 2;
+    point **path = (point**) malloc(n * (sizeof(point*) + sizeof(point)));
+    point *points = (point*) (path + n);
+
+    decode_path(subpop, chr, points);
+    for (i = 0; i < n; i++) path[i] = &points[i];
     return path;
 }
 
 
 void free_path(point **path) {
-    int i;
-    for (i = 0; i < N_POINTS+2; i++) free(path[i]);
     free(path);
 }
 
@@ -238,3 +546,29 @@ int binToDecimal(char* bin, unsigned int begin, unsigned int end) {
     return dec_val;
 }
 
+
+/* ------------------------------------------------------------------------- */
+/* Pack a chromosome of '0' and '1' characters into bits, 8 to a byte, with  */
+/* the first character in the most significant bit of the first byte.        */
+/* chr      : The chromosome to pack                                         */
+/* size     : The number of characters in chr                                */
+/* out      : Receives (size+7)/8 bytes                                      */
+/* ------------------------------------------------------------------------- */
+void pack_chr(char *chr, int size, unsigned char *out) {
+    int i;
+
+    memset(out, 0, (size + 7) / 8);
+    for (i = 0; i < size; i++)
+        if (chr[i] == '1') out[i/8] |= 0x80 >> (i % 8);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Unpack a chromosome packed with pack_chr                                  */
+/* ------------------------------------------------------------------------- */
+void unpack_chr(unsigned char *in, int size, char *chr) {
+    int i;
+    for (i = 0; i < size; i++)
+        chr[i] = (in[i/8] & (0x80 >> (i % 8))) ? '1' : '0';
+}
+
@@ -3,15 +3,24 @@
 #include "types.h"
 
 void    fitness(deme*);
+void    fused_offspring(deme*);
+void    select_kernel(deme*);
 void    fitness_simple(deme*);
 void    fitness_shpath(deme*);
 double  pt_dist(point*, point*);
 int     collision(point*, point*, object*);
+int     point_size(deme*);
+int     coord_bound(deme*);
+int     clamp_coord(double, int);
 int     valid_loc(point*);
 void    pt_copy(point*, point*);
-point   **make_path(char*, point*, point*);
+void    decode_path(deme*, char*, point*);
+void    encode_path(deme*, point*, char*);
+point   **make_path(deme*, char*);
 void    free_path(point**);
 int     binToDecimal(char*, unsigned int, unsigned int);
+void    pack_chr(char*, int, unsigned char*);
+void    unpack_chr(unsigned char*, int, char*);
 
 #endif
 
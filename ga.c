@@ -1,5 +1,5 @@
 /* ========================================================================= */
-/* Main GA loop and genetic operator functions                               */
+/* Migration and genetic operator functions                                  */
 /* ========================================================================= */
 #include <math.h>
 #include <mpi.h>
@@ -7,89 +7,76 @@
 #include <stdlib.h>
 #include <string.h>
 #include "config.h"
-#include "init.h"
 #include "fitness.h"
 #include "ga.h"
 #include "mt_mpi.h"
-#include "report.h"
+#include "profile.h"
 #include "types.h"
 
 
-int main(int argc, char *argv[]) {
-    int my_rank;
-    double mpi_start_time, mpi_end_time;
-    deme *subpop = (deme*) malloc(sizeof(deme));
-
-    MPI_Init(&argc, &argv);
-    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
-    init_population(subpop, argc, argv);
-    mpi_start_time = MPI_Wtime();
-
-    while (!subpop->complete) {
-        migration(subpop);
-        reproduction(subpop);
-        crossover(subpop);
-        mutation(subpop);
-        fitness(subpop);
-        subpop->old_pop = subpop->new_pop;
-        subpop->cur_gen++;
-        check_complete(subpop);
-        sync_complete(subpop);
-        report_all(subpop);
-    }
-
-    mpi_end_time = MPI_Wtime();
-    report_fittest(subpop);
-    MPI_Finalize();
-    printf("[%i] Elapsed time: %f\n", my_rank, mpi_end_time - mpi_start_time);
-    return 1;
-}
-
-
 /* ------------------------------------------------------------------------- */
 /* Exchange members with neighboring subpoulations in a ring arrangement.    */
 /* The least fit member of this subpoulation is exchanged with the most fit  */
 /* member of the neighbor to the right. Also, the most fit member of this    */
 /* subpoulation is exchanged with the least fit member of the left neighbor. */
+/*                                                                           */
+/* With HIER_MIGRATION, there are two rings: demes on the same node exchange */
+/* every MIGRATION_RATE_LOCAL generations over cheap node-local links, while */
+/* one leader per node exchanges with the other nodes' leaders only every    */
+/* MIGRATION_RATE_REMOTE generations. Remote migrants are received first, so */
+/* they spread through the node in the same generation.                      */
 /* ------------------------------------------------------------------------- */
 void migration(deme *subpop) {
-    MPI_Status    status;
-    int my_rank, n_procs;
-    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &n_procs);
-
-    int neighbor1 = my_rank, neighbor2 = my_rank;
-    if (++neighbor1 == n_procs) neighbor1 = 0;
-    if (--neighbor2 == -1) neighbor2 = n_procs - 1;
-
-    char old_min[subpop->chr_size];
-    char new_min[subpop->chr_size];
-    char old_max[subpop->chr_size];
-    char new_max[subpop->chr_size];
-
-    // Send the right neighbor the least fit member of this poulation
-    strncpy(old_min, subpop->old_pop[subpop->fit_min]->chr,
-        subpop->chr_size);
-    MPI_Send(old_min, subpop->chr_size, MPI_CHAR, neighbor1, 50,
-        MPI_COMM_WORLD);
-
-    // Receive the left neighbor's least fit member and add to this population
-    MPI_Recv(new_min, subpop->chr_size, MPI_CHAR, neighbor2, 50,
-        MPI_COMM_WORLD, &status);
-    strncpy(subpop->old_pop[subpop->fit_min]->chr, new_min,
-            subpop->chr_size);
-
-    // Send the left neighbor the most fit member of this poulation
-    strncpy(old_max, subpop->old_pop[subpop->fit_max]->chr,
-        subpop->chr_size);
-    MPI_Send(old_max, subpop->chr_size, MPI_CHAR, neighbor2, 50,
-        MPI_COMM_WORLD);
-
-    // Receive the right neighbor's most fit member and add to this population
-    MPI_Recv(new_max, subpop->chr_size, MPI_CHAR, neighbor1, 50,
-        MPI_COMM_WORLD, &status);
-    strncpy(subpop->old_pop[subpop->fit_max]->chr, new_max,
-            subpop->chr_size);
+    if (!HIER_MIGRATION) {
+        migrate_ring(subpop, &subpop->mig_ring);
+        return;
+    }
+
+    if (subpop->cur_gen % MIGRATION_RATE_REMOTE == 0)
+        migrate_ring(subpop, &subpop->leader_ring);
+    if (subpop->cur_gen % MIGRATION_RATE_LOCAL == 0)
+        migrate_ring(subpop, &subpop->node_ring);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Perform one exchange over a migration ring. Neighbors on the same node    */
+/* publish their migrants in an outbox in shared memory, which is copied     */
+/* directly into this population; other neighbors are reached via messages.  */
+/* The outbox alternates between two slots, so a single barrier per exchange */
+/* keeps a fast process from overwriting migrants that are still being read. */
+/* ------------------------------------------------------------------------- */
+void migrate_ring(deme *subpop, ring *r) {
+    int n = subpop->chr_size;
+    int slot = subpop->shm_epoch * 2 * n;
+    char *min_chr = subpop->old_pop[subpop->fit_min]->chr;
+    char *max_chr = subpop->old_pop[subpop->fit_max]->chr;
+    int to_right = r->right_box ? MPI_PROC_NULL : r->right;
+    int to_left = r->left_box ? MPI_PROC_NULL : r->left;
+    if (r->comm == MPI_COMM_NULL) return;
+
+    // Publish the least and most fit members to node-local neighbors
+    if (r->shm_sync) {
+        memcpy(subpop->outbox + slot, min_chr, n);
+        memcpy(subpop->outbox + slot + n, max_chr, n);
+        MPI_Win_sync(subpop->shm_win);
+        MPI_Barrier(subpop->node_comm);
+        MPI_Win_sync(subpop->shm_win);
+        subpop->shm_epoch ^= 1;
+    }
+
+    // Send the right neighbor the least fit member of this population, and
+    // replace it with the left neighbor's least fit member
+    MPI_Sendrecv_replace(min_chr, n, MPI_CHAR, to_right, 50, to_left, 50,
+        r->comm, MPI_STATUS_IGNORE);
+    if (r->left_box) memcpy(min_chr, r->left_box + slot, n);
+
+    // Send the left neighbor the most fit member of this population, and
+    // replace it with the right neighbor's most fit member
+    MPI_Sendrecv_replace(max_chr, n, MPI_CHAR, to_left, 50, to_right, 50,
+        r->comm, MPI_STATUS_IGNORE);
+    if (r->right_box) memcpy(max_chr, r->right_box + slot + n, n);
+    if (subpop->prof) subpop->prof->bytes_mig += 2*n;
 }
 
 
@@ -97,14 +84,15 @@ void migration(deme *subpop) {
 /* Select an individual in the population by roulette wheel method; a        */
 /* "wheel" is partitioned into sizes proportional to an individual's fitness */
 /* relative to the fitness of the rest of the population.                    */
+/* With SEL_TOURNAMENT, tournament selection is used instead.                */
 /* ------------------------------------------------------------------------- */
 int selection(deme *subpop) {
-    int i, my_rank;
+    int i;
     double current_sum = 0.0;
-    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
-
-    long double rand = mt_rand_real(subpop->fit_tot, my_rank);
+    long double rand;
 
+    if (subpop->cfg.selection == SEL_TOURNAMENT) return tournament(subpop);
+    rand = mt_rand_real(subpop->fit_tot, subpop->rng);
     for (i = 0; i < subpop->pop_size && current_sum <= rand; i++)
         current_sum += subpop->old_pop[i]->fitness;
 
@@ -112,6 +100,44 @@ int selection(deme *subpop) {
 }
 
 
+/* ------------------------------------------------------------------------- */
+/* Select the most fit of tourn_size individuals drawn at random, which      */
+/* depends only on the order of fitness values rather than their scale.      */
+/* ------------------------------------------------------------------------- */
+int tournament(deme *subpop) {
+    int i, k, best = mt_rand_int(subpop->pop_size - 1, subpop->rng);
+
+    for (i = 1; i < subpop->cfg.tourn_size; i++) {
+        k = mt_rand_int(subpop->pop_size - 1, subpop->rng);
+        if (subpop->old_pop[k]->fitness > subpop->old_pop[best]->fitness)
+            best = k;
+    }
+    return best;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Find the n most fit members of the evaluated population, most fit first,  */
+/* keeping ties in population order                                          */
+/* top           : Receives the indices of the members                       */
+/* chosen        : pop_size flags, all 0, of which those of the members are  */
+/*                  set to 1                                                 */
+/* ------------------------------------------------------------------------- */
+void fittest_members(deme *subpop, int n, int *top, char *chosen) {
+    int i, j;
+
+    for (i = 0; i < n; i++) {
+        top[i] = -1;
+        for (j = 0; j < subpop->pop_size; j++) {
+            if (!chosen[j] && (top[i] < 0 || subpop->old_pop[j]->fitness
+                               > subpop->old_pop[top[i]]->fitness))
+                top[i] = j;
+        }
+        chosen[top[i]] = 1;
+    }
+}
+
+
 /* ------------------------------------------------------------------------- */
 /* Randomly pairs individuals, producing from each pair a new pair of        */
 /* offspring. Reproductive probability is determined by relative fitness.    */
@@ -140,72 +166,199 @@ void reproduction(deme *subpop) {
 /* using two-point crossover.                                                */
 /* ------------------------------------------------------------------------- */
 void crossover(deme *subpop) {
-    int i, j, p1, p2, my_rank;
+    int i;
+
+    for (i = 0; i < subpop->pop_size - 1; i += 2)
+        cross_pair(subpop, subpop->new_pop[i], subpop->new_pop[i+1]);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Cross over the parents of a pair of children, or copy them unchanged.     */
+/* Both children must have the same parents. The crossover point is the      */
+/* middle of the chromosome with XO_MIDPOINT, or drawn at random with        */
+/* XO_ONE_POINT; with XO_UNIFORM, each bit is taken from either parent.      */
+/* Integer genomes always use arithmetic crossover instead.                  */
+/* ------------------------------------------------------------------------- */
+void cross_pair(deme *subpop, org *c1, org *c2) {
+    int j;
     int xover_pt = subpop->chr_size/2;
-    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
-
-    for (i = 0; i < subpop->pop_size - 1; i += 2) {
-        p1 = subpop->new_pop[i]->parent1;
-        p2 = subpop->new_pop[i]->parent2;
-
-        if (mt_probability(CROSSOVER_RATE, my_rank)) {
-            for (j = 0; j < xover_pt; j++)
-                subpop->new_pop[i]->chr[j] = subpop->old_pop[p1]->chr[j];
-            for (j = xover_pt; j < subpop->chr_size; j++)
-                subpop->new_pop[i]->chr[j] = subpop->old_pop[p2]->chr[j];
-            for (j = 0; j < xover_pt; j++)
-                subpop->new_pop[i+1]->chr[j] = subpop->old_pop[p2]->chr[j];
-            for (j = xover_pt; j < subpop->chr_size; j++)
-                subpop->new_pop[i+1]->chr[j] = subpop->old_pop[p1]->chr[j];
+    char *p1 = subpop->old_pop[c1->parent1]->chr;
+    char *p2 = subpop->old_pop[c1->parent2]->chr;
+
+    if (mt_probability(subpop->cfg.xover_rate, subpop->rng)) {
+        if (subpop->cfg.genome == GENOME_INT) {
+            cross_ints(subpop, c1, c2, p1, p2);
+            return;
         }
-        else {
-            strncpy(subpop->new_pop[i]->chr, subpop->old_pop[p1]->chr,
-                subpop->chr_size);
-            strncpy(subpop->new_pop[i+1]->chr, subpop->old_pop[p2]->chr,
-                subpop->chr_size);
+        if (subpop->cfg.crossover == XO_UNIFORM) {
+            for (j = 0; j < subpop->chr_size; j++) {
+                if (mt_rand_bit(subpop->rng) == '1') {
+                    c1->chr[j] = p1[j];
+                    c2->chr[j] = p2[j];
+                }
+                else {
+                    c1->chr[j] = p2[j];
+                    c2->chr[j] = p1[j];
+                }
+            }
+            return;
         }
+        if (subpop->cfg.crossover == XO_ONE_POINT)
+            xover_pt = 1 + mt_rand_int(subpop->chr_size - 2, subpop->rng);
+        for (j = 0; j < xover_pt; j++)                 c1->chr[j] = p1[j];
+        for (j = xover_pt; j < subpop->chr_size; j++)  c1->chr[j] = p2[j];
+        for (j = 0; j < xover_pt; j++)                 c2->chr[j] = p2[j];
+        for (j = xover_pt; j < subpop->chr_size; j++)  c2->chr[j] = p1[j];
+    }
+    else {
+        memcpy(c1->chr, p1, subpop->chr_size);
+        memcpy(c2->chr, p2, subpop->chr_size);
     }
 }
 
 
 /* ------------------------------------------------------------------------- */
-/* Mutates bits with a probability defined by MUTATION_RATE                  */
+/* Arithmetic crossover of integer genomes. Each coordinate of the children  */
+/* is a blend a*p1 + (1-a)*p2 of the parents' coordinates, and the reverse,  */
+/* with one random weight a per pair. The parents may be the children, and   */
+/* the chromosomes need not be aligned for ints, so they are blended through */
+/* local copies.                                                             */
+/* ------------------------------------------------------------------------- */
+void cross_ints(deme *subpop, org *c1, org *c2, char *p1, char *p2) {
+    int j, n = subpop->chr_size / sizeof(int);
+    int x1[n], x2[n];
+    double a = mt_rand_real(1, subpop->rng), b = 1 - a;
+
+    memcpy(x1, p1, subpop->chr_size);
+    memcpy(x2, p2, subpop->chr_size);
+    for (j = 0; j < n; j++) {
+        int y1 = (int) lround(a*x1[j] + b*x2[j]);
+        x2[j] = (int) lround(b*x1[j] + a*x2[j]);
+        x1[j] = y1;
+    }
+    memcpy(c1->chr, x1, subpop->chr_size);
+    memcpy(c2->chr, x2, subpop->chr_size);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Mutates bits with a probability defined by the mutation rate              */
 /* For smaller chromosomes, flip a single random bit in each selected string.*/
 /* For larger chromosomes, multiple segments of a chromosome have a chance   */
-/* to be mutated.                                                            */
+/* to be mutated. Each coordinate of an integer genome has a chance to move  */
+/* by a Gaussian step of mut_sigma.                                          */
 /* ------------------------------------------------------------------------- */
 void mutation(deme *subpop) {
-    int i, seg, rand, my_rank;
-    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+    int i;
+    for (i = 0; i < subpop->pop_size; i++)
+        mutate_member(subpop, subpop->new_pop[i]);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Mutate one member, as described for mutation()                            */
+/* ------------------------------------------------------------------------- */
+void mutate_member(deme *subpop, org *member) {
+    int seg, rand, j, n, bound;
+    int coord_size = subpop->cfg.coord_size;
 
     // Simple fitness function with smaller chromosomes
     if (subpop->ff_type == FF_SIMPLE) {
-        for (i = 0; i < subpop->pop_size; i++) {
-            if (mt_probability(MUTATION_RATE, my_rank)) {
-                rand = mt_rand_int(subpop->chr_size, my_rank);
-                if (subpop->new_pop[i]->chr[rand] == '0')
-                    subpop->new_pop[i]->chr[rand] = '1';
-                else subpop->new_pop[i]->chr[rand] = '0';
-            }
+        if (mt_probability(subpop->cfg.mut_rate, subpop->rng)) {
+            rand = mt_rand_int(subpop->chr_size, subpop->rng);
+            if (member->chr[rand] == '0') member->chr[rand] = '1';
+            else member->chr[rand] = '0';
         }
     }
 
+    // Shortest path waypoints as integers
+    else if (subpop->cfg.genome == GENOME_INT) {
+        n = subpop->chr_size / sizeof(int);
+        bound = coord_bound(subpop);
+        int x[n];
+        memcpy(x, member->chr, subpop->chr_size);
+        for (j = 0; j < n; j++) {
+            if (mt_probability(subpop->cfg.mut_rate, subpop->rng))
+                x[j] = clamp_coord(x[j] + subpop->cfg.mut_sigma
+                    * mt_rand_gauss(subpop->rng), bound);
+        }
+        memcpy(member->chr, x, subpop->chr_size);
+    }
+
     // Shortest path fitness function with larger chromosomes
     else if (subpop->ff_type == FF_SHPATH) {
-        for (i = 0; i < subpop->pop_size; i++) {
-            for (seg = 0; seg < subpop->chr_size; seg += COORD_SIZE) {
-                if (mt_probability(MUTATION_RATE, my_rank)) {
-                    rand = seg + mt_rand_int(COORD_SIZE, my_rank);
-                    if (subpop->new_pop[i]->chr[rand] == '0')
-                        subpop->new_pop[i]->chr[rand] = '1';
-                    else subpop->new_pop[i]->chr[rand] = '0';
-                }
+        for (seg = 0; seg < subpop->chr_size; seg += coord_size) {
+            if (mt_probability(subpop->cfg.mut_rate, subpop->rng)) {
+                rand = seg + mt_rand_int(coord_size, subpop->rng);
+                if (member->chr[rand] == '0') member->chr[rand] = '1';
+                else member->chr[rand] = '0';
             }
         }
     }
 }
 
 
+/* ------------------------------------------------------------------------- */
+/* Produce one pair of children from start to finish: select two (distinct)  */
+/* parents, cross them over and mutate both children. Used by the fused      */
+/* offspring pipeline, which evaluates each pair as soon as it is produced.  */
+/* c2 may be NULL for the last member of an odd-sized population, which is   */
+/* then a mutated copy of one parent.                                        */
+/* ------------------------------------------------------------------------- */
+void breed_pair(deme *subpop, org *c1, org *c2) {
+    int p1 = selection(subpop);
+    int p2;
+
+    if (c2 == NULL) {
+        c1->parent1 = c1->parent2 = p1;
+        memcpy(c1->chr, subpop->old_pop[p1]->chr, subpop->chr_size);
+        mutate_member(subpop, c1);
+        return;
+    }
+
+    p2 = selection(subpop);
+    while (p1 == p2) p2 = selection(subpop);
+    c1->parent1 = c2->parent1 = p1;
+    c1->parent2 = c2->parent2 = p2;
+    cross_pair(subpop, c1, c2);
+    mutate_member(subpop, c1);
+    mutate_member(subpop, c2);
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Stop all sub-populations at the same generation once the time limit,      */
+/* less a TIME_RESERVE fraction for the end of the run, is used up. Instead  */
+/* of agreeing on the elapsed time every generation, the slowest process's   */
+/* elapsed time is reduced only at check generations: from the time per      */
+/* generation since the last check, the next check is scheduled halfway to   */
+/* the predicted deadline, so checks become more frequent as it approaches.  */
+/* ------------------------------------------------------------------------- */
+void sync_deadline(deme *subpop) {
+    double elapsed, budget = subpop->time_limit * (1 - TIME_RESERVE);
+    int gens_left = 1;
+
+    if (subpop->cur_gen < subpop->next_check) return;
+
+    elapsed = MPI_Wtime() - subpop->run_start;
+    MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX,
+        subpop->comm);
+    if (elapsed >= budget) {
+        subpop->complete = 1;
+        return;
+    }
+
+    // The first check includes initialization, so it only sets a baseline
+    if (subpop->last_check > 0 && elapsed > subpop->last_check)
+        gens_left = (budget - elapsed) * (subpop->cur_gen - subpop->last_gen)
+            / (elapsed - subpop->last_check);
+    subpop->last_check = elapsed;
+    subpop->last_gen = subpop->cur_gen;
+    subpop->next_check = subpop->cur_gen + (gens_left > 2 ? gens_left/2 : 1);
+}
+
+
 /* ------------------------------------------------------------------------- */
 /* Test if the termination condition has been reached for this sub-population*/
 /* ------------------------------------------------------------------------- */
@@ -235,17 +388,21 @@ void check_complete(deme *subpop) {
 void sync_complete(deme *subpop) {
     MPI_Status status;
     int source, complete, my_rank, n_procs;
-    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &n_procs);
+    my_rank = subpop->rank;
+    MPI_Comm_size(subpop->comm, &n_procs);
 
     if (subpop->end_type == M_FIXED_GENERATIONS) return;
+    if (subpop->end_type == M_WALL_CLOCK) {
+        sync_deadline(subpop);
+        return;
+    }
 
     // If any sub-populations have completed, signal process 0
     if (my_rank != 0)
-        MPI_Send(&subpop->complete, 1, MPI_INT, 0, 50, MPI_COMM_WORLD);
+        MPI_Send(&subpop->complete, 1, MPI_INT, 0, 50, subpop->comm);
     else {
         for (source = 1; source < n_procs; source++) {
-            MPI_Recv(&complete, 1, MPI_INT, source, 50, MPI_COMM_WORLD,
+            MPI_Recv(&complete, 1, MPI_INT, source, 50, subpop->comm,
                 &status);
             if (complete) subpop->complete = 1;
         }
@@ -255,10 +412,10 @@ void sync_complete(deme *subpop) {
     if (my_rank == 0) {
         for (source = 1; source < n_procs; source++)
             MPI_Send(&subpop->complete, 1, MPI_INT, source, 50,
-                MPI_COMM_WORLD);
+                subpop->comm);
     }
     else {
-        MPI_Recv(&complete, 1, MPI_INT, 0, 50, MPI_COMM_WORLD, &status);
+        MPI_Recv(&complete, 1, MPI_INT, 0, 50, subpop->comm, &status);
         if (complete) subpop->complete = 1;
     }
 }
@@ -3,12 +3,20 @@
 #include "types.h"
 
 void    migration(deme*);
+void    migrate_ring(deme*, ring*);
 int     selection(deme*);
+int     tournament(deme*);
+void    fittest_members(deme*, int, int*, char*);
 void    reproduction(deme*);
 void    crossover(deme*);
+void    cross_pair(deme*, org*, org*);
+void    cross_ints(deme*, org*, org*, char*, char*);
 void    mutation(deme*);
+void    mutate_member(deme*, org*);
+void    breed_pair(deme*, org*, org*);
 void    check_complete(deme*);
 void    sync_complete(deme*);
+void    sync_deadline(deme*);
 
 #endif
 
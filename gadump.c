@@ -0,0 +1,135 @@
+/* ========================================================================== */
+/* Offline decoder for binary run logs written with ga -l. Prints the records */
+/* of each log file as human-readable text, in the same format as the GA's    */
+/* own reports, or as CSV.                                                    */
+/* ========================================================================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "config.h"
+#include "fitness.h"
+#include "report.h"
+#include "runlog.h"
+#include "types.h"
+
+
+void    dump_log(char*, int, int, int);
+void    dump_usage(void);
+
+
+int main(int argc, char *argv[]) {
+    int i, opt, csv = 0, chrs = PRNT_CHRS, info = PRNT_INFO;
+
+    while ((opt = getopt(argc, argv, "crRiI")) != -1) {
+        if      (opt == 'c') csv = 1;
+        else if (opt == 'r') chrs = 1;
+        else if (opt == 'R') chrs = 0;
+        else if (opt == 'i') info = 1;
+        else if (opt == 'I') info = 0;
+        else dump_usage();
+    }
+    if (optind >= argc) dump_usage();
+
+    if (csv) printf("rank,gen,record,index,fitness,total,average,chr\n");
+    for (i = optind; i < argc; i++) dump_log(argv[i], csv, chrs, info);
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Print every record in a log file                                           */
+/* filename      : The log file to read                                       */
+/* csv           : Print as CSV if non-zero, as text otherwise                */
+/* chrs          : Print each member's raw chromosome in text if non-zero     */
+/* info          : Print each member's decoded chromosome in text if non-zero */
+/* -------------------------------------------------------------------------- */
+void dump_log(char *filename, int csv, int chrs, int info) {
+    log_header hdr;
+    log_record rec;
+    deme subpop;
+    int n_bytes, chr_size;
+    unsigned char *packed;
+    char *chr;
+    FILE *fp = fopen(filename, "rb");
+
+    if (fp == NULL || fread(&hdr, sizeof(hdr), 1, fp) != 1
+        || hdr.magic != LOG_MAGIC) {
+        fprintf(stderr, "Error: %s is not a run log\n", filename);
+        if (fp != NULL) fclose(fp);
+        return;
+    }
+
+    // Set up just enough of a population to decode its members
+    memset(&subpop, 0, sizeof(subpop));
+    subpop.ff_type = hdr.ff_type;
+    subpop.chr_size = hdr.chr_size;
+    subpop.cfg.n_points = hdr.n_points;
+    subpop.cfg.coord_size = hdr.coord_size;
+    subpop.s = &hdr.s;
+    subpop.t = &hdr.t;
+    packed = (unsigned char*) malloc((hdr.chr_size + 7) / 8);
+    chr = (char*) malloc(hdr.chr_size + 1);
+
+    while (fread(&rec, sizeof(rec), 1, fp) == 1) {
+        if (rec.type == LOG_STAT) {
+            if (csv)
+                printf("%i,%i,stat,%i,%f,%f,%f,\n", hdr.rank, rec.gen,
+                    rec.index, rec.value[2], rec.value[0], rec.value[1]);
+            else {
+                printf("[Deme %03i][Gen %06i] ", hdr.rank, rec.gen);
+                printf("Total:%08.0f ", rec.value[0]);
+                printf("Avg:%06.0f ", rec.value[1]);
+                printf("Max[%03i]: ", rec.index+1);
+                printf("%.0f\n", rec.value[2]);
+            }
+        }
+        else if (rec.type == LOG_MEMBER) {
+            // Members of a multi-resolution run grow over the run
+            chr_size = (rec.chr_size > 0) ? rec.chr_size : hdr.chr_size;
+            if (chr_size > hdr.chr_size) {
+                fprintf(stderr, "Error: Corrupt record in %s\n", filename);
+                break;
+            }
+            n_bytes = (chr_size + 7) / 8;
+            if (fread(packed, 1, n_bytes, fp) != n_bytes) break;
+            unpack_chr(packed, chr_size, chr);
+            chr[chr_size] = '\0';
+            subpop.chr_size = chr_size;
+            if (hdr.ff_type == FF_SHPATH)
+                subpop.cfg.n_points = chr_size / (3 * hdr.coord_size);
+            if (csv)
+                printf("%i,%i,member,%i,%f,,,%s\n", hdr.rank, rec.gen,
+                    rec.index, rec.value[0], chr);
+            else {
+                printf("[Deme %03i][Gen %06i] %03i: ", hdr.rank, rec.gen,
+                    rec.index+1);
+                if (chrs) printf("%s ", chr);
+                if (info) report_member(&subpop, chr);
+                printf("%.0f\n", rec.value[0]);
+            }
+        }
+        else {
+            fprintf(stderr, "Error: Corrupt record in %s\n", filename);
+            break;
+        }
+    }
+
+    free(packed);
+    free(chr);
+    fclose(fp);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Print a usage statement and exit the program                               */
+/* -------------------------------------------------------------------------- */
+void dump_usage() {
+    printf("\n\nUsage: gadump [options] FILE...\n");
+    printf("\t-c: Print records as CSV instead of text\n");
+    printf("\t-r, -R: Print, or omit, each member's raw chromosome in\n");
+    printf("\t    text (default: %s)\n", PRNT_CHRS ? "print" : "omit");
+    printf("\t-i, -I: Print, or omit, each member's decoded chromosome in\n");
+    printf("\t    text (default: %s)\n\n", PRNT_INFO ? "print" : "omit");
+    exit(-1);
+}
@@ -7,142 +7,897 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "checkpoint.h"
 #include "config.h"
 #include "init.h"
 #include "fitness.h"
+#include "islands.h"
 #include "mt_mpi.h"
+#include "params.h"
+#include "placement.h"
+#include "profile.h"
 #include "report.h"
+#include "runlog.h"
+#include "seeding.h"
+#include "shapes.h"
+#include "snapshot.h"
+#include "surrogate.h"
 #include "types.h"
 
 
+/* -------------------------------------------------------------------------- */
+/* Program parameters as shared by process 0 with all other processes         */
+/* -------------------------------------------------------------------------- */
+typedef struct {
+    int         rand_seed;
+    int         pop_size;
+    int         ff_type;
+    int         end_type;
+    int         end_gen;
+    int         conv_gen;
+    double      f_thresh;
+    double      conv_var;
+    double      time_limit;
+    point       s;
+    point       t;
+    int         n_objs;
+    int         n_shapes[SHAPE_KINDS];
+    int         islands_len;
+    settings    cfg;
+} shared_params;
+
+
 /* -------------------------------------------------------------------------- */
 /* Initializes a population at generation 0.                                  */
 /* Program parameters may be initialized to default values, user-specified    */
-/* values, or values from a file. Initial population is randomly generated.   */
+/* values, or values from a file, which are read by process 0 and then shared */
+/* with all other processes. Initial population is randomly generated,        */
+/* or loaded from a snapshot, unless the run is restarted from a checkpoint.  */
 /* This function is responsible for initializing the random number generator  */
 /* with a seed value (if specified).                                          */
+/* Errors are reported, and all processes give up together on an error of     */
+/* any one, with nothing left allocated.                                      */
 /* subpop        : The poulation and other parameters to initialize           */
+/* comm          : The communicator of the processes taking part in the run   */
+/* return        : INIT_OK if the run is ready, INIT_EXPORTED if the command  */
+/*                  line only exports parameters, and INIT_FAILED if the      */
+/*                  command line, parameters or any file read are invalid     */
 /* -------------------------------------------------------------------------- */
-void init_population(deme *subpop, int argc, char *argv[]) {
-    int i, j, my_rank, n_procs, init_type = 0;
-    char *filename = "";
-    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &n_procs);
+int init_population(deme *subpop, MPI_Comm comm, int argc, char *argv[]) {
+    int i, j, my_rank, init_type = 0, status = INIT_OK;
+    char *filename = "", *restart = NULL, *logfile = NULL, *seed = NULL;
+    char *overrides = NULL, *prof_file = NULL;
+    int prof_hw = 0;
+    subpop->comm = comm;
+    MPI_Comm_rank(subpop->comm, &subpop->rank);
+    my_rank = subpop->rank;
 
+    subpop->run_start = MPI_Wtime();
+    subpop->time_limit = DEFAULT_TIME_LIMIT;
+    subpop->next_check = 0;
+    subpop->last_check = 0.0;
+    subpop->last_gen = 0;
+    subpop->res_best = 0.0;
     subpop->fit_tot = 0.0;
     subpop->fit_avg = 0.0;
     subpop->fit_prev = 0.0;
     subpop->fit_novar = 0;
+    subpop->stag_best = 0.0;
+    subpop->stag_gens = 0;
+    subpop->n_restarts = 0;
     subpop->fit_max = 0;
     subpop->fit_min = 0;
     subpop->cur_gen = 0;
     subpop->complete = 0;
+    subpop->n_evals = 0;
+    subpop->prior_time = 0.0;
+    subpop->skip = NULL;
+    subpop->n_skip = 0;
+    subpop->surr = NULL;
+    for (i = 0; i < MAX_TARGETS; i++) subpop->tgt_gen[i] = -1;
+    subpop->ckpt_file = NULL;
+    subpop->ckpt_rate = CKPT_RATE;
+    subpop->ckpt_buf = NULL;
+    subpop->log = NULL;
+    subpop->snap_file = NULL;
+    subpop->prof = NULL;
+    subpop->islands = NULL;
+    subpop->shapes = NULL;
+    subpop->s = NULL;
+    subpop->t = NULL;
+    subpop->objs = NULL;
+    subpop->n_objs = 0;
+    subpop->place = NULL;
+    default_settings(&subpop->cfg);
+
+    // Get any command line arguments. Every process parses them alike, so
+    // all give up together on an invalid command line.
+    if      (argc == 1)                                     init_type = 0;
+    else if (strcmp(argv[1], "-d")  == 0)                   init_type = 0;
+    else if (strcmp(argv[1], "-u")  == 0)                   init_type = 1;
+    else if (argc >= 3 && strcmp(argv[1], "-de") == 0)      init_type = 2;
+    else if (argc >= 3 && strcmp(argv[1], "-ue") == 0)      init_type = 3;
+    else if (argc >= 3 && strcmp(argv[1], "-i")  == 0)      init_type = 4;
+    else                                                    init_type = -1;
+    if (init_type >= 2 && init_type <= 4)                   filename = argv[2];
+
+    // Get any options following the initialization flag
+    for (i = (init_type >= 2) ? 3 : 2; i < argc && init_type >= 0; i += 2) {
+        if      (i+1 >= argc)                               init_type = -1;
+        else if (strcmp(argv[i], "-c") == 0)    subpop->ckpt_file = argv[i+1];
+        else if (strcmp(argv[i], "-r") == 0)    restart = argv[i+1];
+        else if (strcmp(argv[i], "-l") == 0)    logfile = argv[i+1];
+        else if (strcmp(argv[i], "-s") == 0)    seed = argv[i+1];
+        else if (strcmp(argv[i], "-o") == 0)    subpop->snap_file = argv[i+1];
+        else if (strcmp(argv[i], "-t") == 0)    prof_file = argv[i+1];
+        else if (strcmp(argv[i], "-T") == 0) {
+            prof_file = argv[i+1];
+            prof_hw = 1;
+        }
+        else if (strcmp(argv[i], "-p") == 0) {
+            overrides = add_override(overrides, argv[i+1]);
+            if (overrides == NULL) init_type = -1;
+        }
+        else init_type = -1;
+    }
+    if (init_type < 0) {
+        if (my_rank == 0) usage();
+        free(overrides);
+        return INIT_FAILED;
+    }
 
-    // Get any command line arguments
-    if        (argc == 1)                                    init_type = 0;
-    else if    (argc == 2 && strcmp(argv[1], "-d")  == 0)    init_type = 0;
-    else if    (argc == 2 && strcmp(argv[1], "-u")  == 0)    init_type = 1;
-    else if    (argc == 3 && strcmp(argv[1], "-de") == 0)    init_type = 2;
-    else if    (argc == 3 && strcmp(argv[1], "-ue") == 0)    init_type = 3;
-    else if    (argc == 3 && strcmp(argv[1], "-i")  == 0)    init_type = 4;
-    else usage();
-    if (init_type >= 2 && init_type <= 4)                    filename = argv[2];
-
-    // Quick fix; TODO: initialize on processor 0 then send data to rest
-    if((init_type == 1 || init_type == 3) && n_procs > 1) {
-        if (my_rank == 0)
-        printf("Please run on one processor when initializing from input\n");
-        MPI_Finalize();
-        exit(-1);
-    }
-
-    // Set program parameters (from either defaults, user, or file)
-    if (init_type == 1 || init_type == 3) get_input(subpop);
-    else if (init_type == 0) {
-        subpop->rand_seed     = DEFAULT_RAND_SEED;
-        subpop->pop_size     = DEFAULT_POP_SIZE;
-        subpop->end_type     = DEFAULT_END_TYPE;
-        subpop->end_gen         = DEFAULT_END_GENERATION;
-        subpop->ff_type         = DEFAULT_FF_TYPE;
-        subpop->conv_gen     = DEFAULT_CONV_GENS;
-        subpop->conv_var     = DEFAULT_CONV_VARIATION;
-        if (subpop->ff_type == FF_SIMPLE)
-            subpop->f_thresh = DEFAULT_F_THRESH_SIMPLE;
-        else if (subpop->ff_type == FF_SHPATH)
-            subpop->f_thresh = DEFAULT_F_THRESH_SHPATH;
-        else subpop->f_thresh = 0;
-    }
-    if (init_type == 4) import_population(subpop, filename);
-
-    // Allocate and randomize population
-    mt_init(my_rank, subpop->rand_seed);
+    // Set program parameters (from either defaults, user, or file) on
+    // process 0 only, then share them with all other processes
+    if (my_rank == 0) {
+        if (init_type == 1 || init_type == 3) get_input(subpop);
+        else if (init_type == 0 || init_type == 2) {
+            subpop->rand_seed     = DEFAULT_RAND_SEED;
+            subpop->pop_size      = DEFAULT_POP_SIZE;
+            subpop->end_type      = DEFAULT_END_TYPE;
+            subpop->end_gen       = DEFAULT_END_GENERATION;
+            subpop->ff_type       = DEFAULT_FF_TYPE;
+            subpop->conv_gen      = DEFAULT_CONV_GENS;
+            subpop->conv_var      = DEFAULT_CONV_VARIATION;
+            if (subpop->ff_type == FF_SIMPLE)
+                subpop->f_thresh = DEFAULT_F_THRESH_SIMPLE;
+            else if (subpop->ff_type == FF_SHPATH)
+                subpop->f_thresh = DEFAULT_F_THRESH_SHPATH;
+            else subpop->f_thresh = 0;
+        }
+        if (init_type == 4 && import_population(subpop, filename) != 0)
+            status = INIT_FAILED;
+        if (status == INIT_OK && overrides != NULL)
+            override_params(subpop, overrides);
+        else free(overrides);
+        if (status == INIT_OK
+            && (test_input(subpop) || test_islands(subpop))) {
+            usage2();
+            status = INIT_FAILED;
+        }
+        if (status == INIT_OK && subpop->cfg.genome == GENOME_INT
+            && (logfile != NULL || seed != NULL || subpop->snap_file != NULL)) {
+            fprintf(stderr, "Error: Run logs and snapshots need the binary "
+                "genome\n");
+            status = INIT_FAILED;
+        }
+        if (status == INIT_OK && (init_type == 2 || init_type == 3))
+            status = (export_population(subpop, filename) == 0)
+                ? INIT_EXPORTED : INIT_FAILED;
+    }
+    else free(overrides);
+
+    // Only process 0 has read the parameters, so it tells the others if the
+    // run goes ahead
+    MPI_Bcast(&status, 1, MPI_INT, 0, subpop->comm);
+    if (status != INIT_OK) {
+        release_params(subpop);
+        return status;
+    }
+    share_params(subpop);
+    island_settings(subpop, my_rank);
+
+    // Allocate and randomize population, with room for the largest
+    // chromosomes of a multi-resolution run
+    subpop->rng = (mt_state*) malloc(sizeof(mt_state));
+    mt_init(subpop->rng, my_rank, subpop->rand_seed);
     if         (subpop->ff_type == FF_SIMPLE)   subpop->chr_size = CHR_SIZE_SIMPLE;
-    else if (subpop->ff_type == FF_SHPATH)      subpop->chr_size = CHR_SIZE_SHPATH;
+    else if (subpop->ff_type == FF_SHPATH)
+        subpop->chr_size = point_size(subpop) * subpop->cfg.n_points;
     else                                        subpop->chr_size = 0;
-    subpop->old_pop = (org**) malloc(sizeof(org*) * subpop->pop_size);
-    subpop->new_pop = (org**) malloc(sizeof(org*) * subpop->pop_size);
+    subpop->chr_max = subpop->chr_size;
+    if (subpop->ff_type == FF_SHPATH && subpop->cfg.n_points_start > 0
+        && subpop->cfg.n_points_start < subpop->cfg.n_points) {
+        subpop->cfg.n_points = subpop->cfg.n_points_start;
+        subpop->chr_size = point_size(subpop) * subpop->cfg.n_points;
+    }
+    init_topology(subpop);
+    placement_open(subpop);
+    place_objects(subpop);
+    alloc_population(subpop);
+    if (HIER_MIGRATION) {
+        init_ring(subpop, &subpop->node_ring, subpop->node_comm);
+        init_ring(subpop, &subpop->leader_ring, subpop->leader_comm);
+    }
+    else init_ring(subpop, &subpop->mig_ring, subpop->comm);
+    for (i = 0; i < subpop->pop_size; i++) {
+        if (subpop->ff_type == FF_SHPATH && subpop->cfg.genome == GENOME_INT)
+            random_path(subpop, subpop->old_pop[i]->chr);
+        else for (j = 0; j < subpop->chr_max; j++)
+            subpop->old_pop[i]->chr[j] = mt_rand_bit(subpop->rng);
+    }
+    seed_population(subpop);
+
+    select_kernel(subpop);
+    if (seed != NULL && load_snapshot(subpop, seed) < 0) status = INIT_FAILED;
+    surrogate_open(subpop);
+    if (restart != NULL && read_checkpoint(subpop, restart) != 0)
+        status = INIT_FAILED;
+    if (logfile != NULL && runlog_open(subpop, logfile) != 0)
+        status = INIT_FAILED;
+
+    // Any process may fail to read its files, and then all give up
+    MPI_Allreduce(MPI_IN_PLACE, &status, 1, MPI_INT, MPI_MIN, subpop->comm);
+    if (status != INIT_OK) {
+        runlog_close(subpop);
+        free_population(subpop);
+        return status;
+    }
+    if (restart == NULL) fitness(subpop);
+    if (prof_file != NULL) profile_open(subpop, prof_file, prof_hw);
+    placement_report(subpop);
+    return INIT_OK;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Groups processes by node. The processes sharing a node's memory form       */
+/* node_comm; the first process on each node is its leader, and the leaders   */
+/* of all nodes form leader_comm.                                             */
+/* -------------------------------------------------------------------------- */
+void init_topology(deme *subpop) {
+    int my_rank, node_rank;
+    my_rank = subpop->rank;
+
+    MPI_Comm_split_type(subpop->comm, MPI_COMM_TYPE_SHARED, 0,
+        MPI_INFO_NULL, &subpop->node_comm);
+    MPI_Comm_rank(subpop->node_comm, &node_rank);
+    MPI_Comm_split(subpop->comm, node_rank == 0 ? 0 : MPI_UNDEFINED,
+        my_rank, &subpop->leader_comm);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Allocates the members of a population. Chromosomes of both generations are */
+/* laid out in one contiguous pool, preceded by the migrant outbox. When      */
+/* SHM_MIGRATION is enabled, the pool is allocated in a shared memory window  */
+/* spanning all processes on this node, so that node-local neighbors can read */
+/* migrants directly instead of receiving them through MPI messages.          */
+/* Each chromosome is followed by one byte of slack, since mt_rand_int() may  */
+/* return its upper bound when mutation picks a bit. Chromosomes and outbox   */
+/* are sized for chr_max, the largest chromosome of the run. The members of   */
+/* both generations, and the arrays of pointers to them, are each allocated   */
+/* as one block, which free_population releases.                              */
+/* -------------------------------------------------------------------------- */
+void alloc_population(deme *subpop) {
+    int i;
+    char *base;
+    org *members;
+    MPI_Info info;
+    int stride = subpop->chr_max + 1;
+    MPI_Aint size = (MPI_Aint) 4*subpop->chr_max + 2*subpop->pop_size*stride;
+
+    subpop->shm_epoch = 0;
+    if (SHM_MIGRATION) {
+        // Keep each segment separate so it is first touched by its owner
+        MPI_Info_create(&info);
+        MPI_Info_set(info, "alloc_shared_noncontig", "true");
+        MPI_Win_allocate_shared(size, 1, info, subpop->node_comm, &base,
+            &subpop->shm_win);
+        MPI_Info_free(&info);
+
+        // The window stays in a passive target epoch for the whole run, as
+        // MPI_Win_sync requires when migrate_ring publishes migrants
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, subpop->shm_win);
+    }
+    else {
+        subpop->shm_win = MPI_WIN_NULL;
+        base = (char*) place_alloc(subpop, sizeof(char) * size);
+    }
+    if (SHM_MIGRATION) place_shared(subpop, base, size);
+
+    subpop->outbox = base;
+    subpop->chr_pool = base + 4*subpop->chr_max;
+    members = (org*) place_alloc(subpop, sizeof(org) * 2 * subpop->pop_size);
+    subpop->old_pop = (org**) place_alloc(subpop,
+        sizeof(org*) * 2 * subpop->pop_size);
+    subpop->new_pop = subpop->old_pop + subpop->pop_size;
     for (i = 0; i < subpop->pop_size; i++) {
-        subpop->old_pop[i] = (org*) malloc(sizeof(org));
-        subpop->old_pop[i]->chr = (char*) malloc(sizeof(char)
-            * subpop->chr_size);
-        subpop->new_pop[i] = (org*) malloc(sizeof(org));
-        subpop->new_pop[i]->chr = (char*) malloc(sizeof(char)
-            * subpop->chr_size);
-        for (j = 0; j < subpop->chr_size; j++)
-            subpop->old_pop[i]->chr[j] = mt_rand_bit(my_rank);
-    }
-
-    if(init_type == 1 || init_type == 3 || init_type == 4) test_input(subpop);
-    if(init_type == 2 || init_type == 3) export_population(subpop, filename);
-    else fitness(subpop);
+        subpop->old_pop[i] = &members[i];
+        subpop->old_pop[i]->chr = subpop->chr_pool + i*stride;
+        subpop->new_pop[i] = &members[subpop->pop_size + i];
+        subpop->new_pop[i]->chr = subpop->chr_pool
+            + (subpop->pop_size + i)*stride;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Release everything allocated by init_population, once the run is over and  */
+/* its reports, run log and checkpoints are finished. This is collective over */
+/* the processes of the run, since it frees the shared memory window and the  */
+/* communicators made by init_topology.                                       */
+/* -------------------------------------------------------------------------- */
+void free_population(deme *subpop) {
+    // old_pop may alias new_pop by now, but new_pop is never reassigned
+    org **pointers = subpop->new_pop - subpop->pop_size;
+
+    if (!place_free(subpop, pointers[0])) free(pointers[0]);
+    if (!place_free(subpop, pointers)) free(pointers);
+    if (subpop->shm_win != MPI_WIN_NULL) {
+        MPI_Win_unlock_all(subpop->shm_win);
+        MPI_Win_free(&subpop->shm_win);
+    }
+    else if (!place_free(subpop, subpop->outbox)) free(subpop->outbox);
+    if (subpop->leader_comm != MPI_COMM_NULL)
+        MPI_Comm_free(&subpop->leader_comm);
+    MPI_Comm_free(&subpop->node_comm);
+
+    release_params(subpop);
+    surrogate_close(subpop);
+    placement_close(subpop);
+    free(subpop->rng);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Release the parameters of a run that are allocated when they are read or   */
+/* shared: its scene and its island settings. Process 0 also calls it when a  */
+/* run does not go ahead, after reading some of them.                         */
+/* -------------------------------------------------------------------------- */
+void release_params(deme *subpop) {
+    if (subpop->objs != NULL && !place_free(subpop, subpop->objs)) {
+        if (subpop->n_objs > 0) {
+            free(subpop->objs[0]->center);
+            free(subpop->objs[0]);
+        }
+        free(subpop->objs);
+    }
+    shapes_destroy(subpop->shapes);
+    free(subpop->s);
+    free(subpop->t);
+    free(subpop->islands);
+    subpop->objs = NULL;
+    subpop->shapes = NULL;
+    subpop->s = NULL;
+    subpop->t = NULL;
+    subpop->islands = NULL;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Lays out a migration ring over a communicator. Neighbors that share this   */
+/* node's memory window are recorded with a pointer to their outbox; all      */
+/* others are reached through MPI messages. This must be called by every      */
+/* process on the node, including those that are not part of comm.            */
+/* subpop        : The population that owns the shared memory window          */
+/* r             : The ring to initialize                                     */
+/* comm          : The communicator to lay the ring out over, or              */
+/*                  MPI_COMM_NULL if this process is not part of the ring     */
+/* -------------------------------------------------------------------------- */
+void init_ring(deme *subpop, ring *r, MPI_Comm comm) {
+    int my_rank, n_procs, uses_shm;
+    int world[2], local[2];
+    MPI_Group group, node_group;
+
+    r->comm = MPI_COMM_NULL;
+    r->left_box = NULL;
+    r->right_box = NULL;
+    r->shm_sync = 0;
+
+    // A ring of a single leader has nobody to exchange with
+    if (comm != MPI_COMM_NULL) {
+        MPI_Comm_size(comm, &n_procs);
+        if (comm == subpop->node_comm || n_procs > 1) r->comm = comm;
+    }
+
+    if (r->comm != MPI_COMM_NULL) {
+        MPI_Comm_rank(comm, &my_rank);
+        r->left = (my_rank + n_procs - 1) % n_procs;
+        r->right = (my_rank + 1) % n_procs;
+
+        // Find the node-local ranks of both neighbors, if any
+        if (subpop->shm_win != MPI_WIN_NULL) {
+            world[0] = r->left;
+            world[1] = r->right;
+            MPI_Comm_group(comm, &group);
+            MPI_Comm_group(subpop->node_comm, &node_group);
+            MPI_Group_translate_ranks(group, 2, world, node_group, local);
+            MPI_Group_free(&group);
+            MPI_Group_free(&node_group);
+
+            r->left_box = shared_outbox(subpop, local[0]);
+            r->right_box = shared_outbox(subpop, local[1]);
+        }
+    }
+
+    // Every process on the node must take part in the same synchronization
+    uses_shm = (r->left_box != NULL || r->right_box != NULL);
+    MPI_Allreduce(&uses_shm, &r->shm_sync, 1, MPI_INT, MPI_LOR,
+        subpop->node_comm);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Find the outbox of a process in this node's shared memory window           */
+/* node_rank     : The rank of the process in node_comm, or MPI_UNDEFINED     */
+/* return        : A pointer to the process's outbox; NULL if it is not on    */
+/*                  this node                                                 */
+/* -------------------------------------------------------------------------- */
+char *shared_outbox(deme *subpop, int node_rank) {
+    MPI_Aint size;
+    int disp_unit;
+    char *base;
+
+    if (node_rank == MPI_UNDEFINED) return NULL;
+    MPI_Win_shared_query(subpop->shm_win, node_rank, &size, &disp_unit,
+        &base);
+    return base;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Share program parameters from process 0 with all other processes. The      */
+/* parameters are sent as one flat block, followed by the obstacles, if any,  */
+/* as a flat array of (x, y, z, radius) values, and the records of any other  */
+/* obstacles as read from a binary obstacle file.                             */
+/* -------------------------------------------------------------------------- */
+void share_params(deme *subpop) {
+    int i, my_rank, n_ints;
+    int *objs;
+    shared_params p;
+    my_rank = subpop->rank;
+
+    if (my_rank == 0) {
+        p.rand_seed = subpop->rand_seed;
+        p.pop_size = subpop->pop_size;
+        p.ff_type = subpop->ff_type;
+        p.end_type = subpop->end_type;
+        p.end_gen = subpop->end_gen;
+        p.conv_gen = subpop->conv_gen;
+        p.f_thresh = subpop->f_thresh;
+        p.conv_var = subpop->conv_var;
+        p.time_limit = subpop->time_limit;
+        p.cfg = subpop->cfg;
+        p.n_objs = 0;
+        shape_records(subpop->shapes, p.n_shapes);
+        p.islands_len = 0;
+        if (subpop->islands != NULL) p.islands_len = strlen(subpop->islands);
+        if (subpop->ff_type == FF_SHPATH) {
+            pt_copy(&p.s, subpop->s);
+            pt_copy(&p.t, subpop->t);
+            p.n_objs = subpop->n_objs;
+        }
+    }
+    MPI_Bcast(&p, sizeof(p), MPI_BYTE, 0, subpop->comm);
+
+    if (my_rank != 0) {
+        subpop->rand_seed = p.rand_seed;
+        subpop->pop_size = p.pop_size;
+        subpop->ff_type = p.ff_type;
+        subpop->end_type = p.end_type;
+        subpop->end_gen = p.end_gen;
+        subpop->conv_gen = p.conv_gen;
+        subpop->f_thresh = p.f_thresh;
+        subpop->conv_var = p.conv_var;
+        subpop->time_limit = p.time_limit;
+        subpop->cfg = p.cfg;
+        if (subpop->ff_type == FF_SHPATH) {
+            subpop->s = (point*) malloc(sizeof(point));
+            subpop->t = (point*) malloc(sizeof(point));
+            pt_copy(subpop->s, &p.s);
+            pt_copy(subpop->t, &p.t);
+            subpop->n_objs = p.n_objs;
+            alloc_objects(subpop);
+        }
+    }
+
+    // Island settings are shared as text, and each process applies its own
+    if (p.islands_len > 0) {
+        if (my_rank != 0) subpop->islands = (char*) malloc(p.islands_len + 1);
+        MPI_Bcast(subpop->islands, p.islands_len + 1, MPI_CHAR, 0,
+            subpop->comm);
+    }
+
+    n_ints = shape_ints(p.n_shapes);
+    if (n_ints > 0) {
+        if (my_rank == 0) objs = shape_records(subpop->shapes, p.n_shapes);
+        else objs = (int*) malloc(sizeof(int) * n_ints);
+        MPI_Bcast(objs, n_ints, MPI_INT, 0, subpop->comm);
+        if (my_rank != 0) subpop->shapes = shapes_create(p.n_shapes, objs);
+    }
+    if (p.n_objs == 0) return;
+
+    objs = (int*) malloc(sizeof(int) * 4 * p.n_objs);
+    if (my_rank == 0) {
+        for (i = 0; i < p.n_objs; i++) {
+            objs[4*i]   = subpop->objs[i]->center->x;
+            objs[4*i+1] = subpop->objs[i]->center->y;
+            objs[4*i+2] = subpop->objs[i]->center->z;
+            objs[4*i+3] = subpop->objs[i]->radius;
+        }
+    }
+    MPI_Bcast(objs, 4 * p.n_objs, MPI_INT, 0, subpop->comm);
+    if (my_rank != 0) {
+        for (i = 0; i < p.n_objs; i++) {
+            subpop->objs[i]->center->x = objs[4*i];
+            subpop->objs[i]->center->y = objs[4*i+1];
+            subpop->objs[i]->center->z = objs[4*i+2];
+            subpop->objs[i]->radius    = objs[4*i+3];
+        }
+    }
+    free(objs);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Set GA settings to their defaults from config.h                            */
+/* -------------------------------------------------------------------------- */
+void default_settings(settings *cfg) {
+    cfg->xover_rate = CROSSOVER_RATE;
+    cfg->mut_rate   = MUTATION_RATE;
+    cfg->selection  = SELECTION;
+    cfg->tourn_size = TOURN_SIZE;
+    cfg->crossover  = CROSSOVER;
+    cfg->n_points   = N_POINTS;
+    cfg->n_points_start = N_POINTS_START;
+    cfg->res_gens   = RES_GENS;
+    cfg->coord_size = COORD_SIZE;
+    cfg->coll_cost  = COLLISION_COST;
+    cfg->genome     = GENOME;
+    cfg->mut_sigma  = MUT_SIGMA;
+    cfg->ls_top     = LS_TOP;
+    cfg->ls_probes  = LS_PROBES;
+    cfg->ls_step    = LS_STEP;
+    cfg->seed_line  = SEED_LINE;
+    cfg->seed_detour = SEED_DETOUR;
+    cfg->seed_jitter = SEED_JITTER;
+    cfg->surr_frac  = SURR_FRAC;
+    cfg->surr_k     = SURR_K;
+    cfg->restart_gens = RESTART_GENS;
+    cfg->restart_elite = RESTART_ELITE;
+    cfg->fused      = FUSED_PIPELINE;
+    cfg->numa_alloc = NUMA_ALLOC;
+    cfg->huge_pages = HUGE_PAGES;
+    cfg->prnt_rate  = PRNT_RATE;
+    cfg->prnt_data  = PRNT_DATA;
+    cfg->prnt_stat  = PRNT_STAT;
+    cfg->prnt_chrs  = PRNT_CHRS;
+    cfg->prnt_info  = PRNT_INFO;
+    cfg->prnt_fits  = PRNT_FITS;
+    cfg->n_targets  = 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Read GA settings from a parameter index. Settings are optional, and any    */
+/* that are missing keep their current values.                                */
+/* -------------------------------------------------------------------------- */
+void get_settings(deme *subpop, param_index *idx) {
+    char *value, *end;
+    settings *cfg = &subpop->cfg;
+
+    if (find_param(idx, "crossover_rate:"))
+        cfg->xover_rate = param_value(idx, "crossover_rate:");
+    if (find_param(idx, "mutation_rate:"))
+        cfg->mut_rate   = param_value(idx, "mutation_rate:");
+    if (find_param(idx, "selection:"))
+        cfg->selection  = param_value(idx, "selection:");
+    if (find_param(idx, "tourn_size:"))
+        cfg->tourn_size = param_value(idx, "tourn_size:");
+    if (find_param(idx, "crossover:"))
+        cfg->crossover  = param_value(idx, "crossover:");
+    if (find_param(idx, "n_points:"))
+        cfg->n_points   = param_value(idx, "n_points:");
+    if (find_param(idx, "n_points_start:"))
+        cfg->n_points_start = param_value(idx, "n_points_start:");
+    if (find_param(idx, "res_gens:"))
+        cfg->res_gens   = param_value(idx, "res_gens:");
+    if (find_param(idx, "coord_size:"))
+        cfg->coord_size = param_value(idx, "coord_size:");
+    if (find_param(idx, "collision_cost:"))
+        cfg->coll_cost  = param_value(idx, "collision_cost:");
+    if (find_param(idx, "genome:"))
+        cfg->genome     = param_value(idx, "genome:");
+    if (find_param(idx, "mut_sigma:"))
+        cfg->mut_sigma  = param_value(idx, "mut_sigma:");
+    if (find_param(idx, "ls_top:"))
+        cfg->ls_top     = param_value(idx, "ls_top:");
+    if (find_param(idx, "ls_probes:"))
+        cfg->ls_probes  = param_value(idx, "ls_probes:");
+    if (find_param(idx, "ls_step:"))
+        cfg->ls_step    = param_value(idx, "ls_step:");
+    if (find_param(idx, "seed_line:"))
+        cfg->seed_line  = param_value(idx, "seed_line:");
+    if (find_param(idx, "seed_detour:"))
+        cfg->seed_detour = param_value(idx, "seed_detour:");
+    if (find_param(idx, "seed_jitter:"))
+        cfg->seed_jitter = param_value(idx, "seed_jitter:");
+    if (find_param(idx, "surr_frac:"))
+        cfg->surr_frac  = param_value(idx, "surr_frac:");
+    if (find_param(idx, "surr_k:"))
+        cfg->surr_k     = param_value(idx, "surr_k:");
+    if (find_param(idx, "restart_gens:"))
+        cfg->restart_gens = param_value(idx, "restart_gens:");
+    if (find_param(idx, "restart_elite:"))
+        cfg->restart_elite = param_value(idx, "restart_elite:");
+    if (find_param(idx, "fused:"))
+        cfg->fused      = param_value(idx, "fused:");
+    if (find_param(idx, "numa_alloc:"))
+        cfg->numa_alloc = param_value(idx, "numa_alloc:");
+    if (find_param(idx, "huge_pages:"))
+        cfg->huge_pages = param_value(idx, "huge_pages:");
+    if (find_param(idx, "prnt_rate:"))
+        cfg->prnt_rate  = param_value(idx, "prnt_rate:");
+    if (find_param(idx, "prnt_data:"))
+        cfg->prnt_data  = param_value(idx, "prnt_data:");
+    if (find_param(idx, "prnt_stat:"))
+        cfg->prnt_stat  = param_value(idx, "prnt_stat:");
+    if (find_param(idx, "prnt_chrs:"))
+        cfg->prnt_chrs  = param_value(idx, "prnt_chrs:");
+    if (find_param(idx, "prnt_info:"))
+        cfg->prnt_info  = param_value(idx, "prnt_info:");
+    if (find_param(idx, "prnt_fits:"))
+        cfg->prnt_fits  = param_value(idx, "prnt_fits:");
+
+    // Targets are a comma-separated list, e.g. targets: 40000,45000,50000
+    value = find_param(idx, "targets:");
+    if (value != NULL) {
+        for (cfg->n_targets = 0; *value != '\0'; cfg->n_targets++) {
+            if (cfg->n_targets == MAX_TARGETS) {
+                cfg->n_targets = -1;
+                break;
+            }
+            cfg->targets[cfg->n_targets] = strtod(value, &end);
+            if (end == value || (*end != ',' && *end != '\0')) {
+                cfg->n_targets = -1;
+                break;
+            }
+            value = (*end == ',') ? end + 1 : end;
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Append a command line override of the form key=value to a list of          */
+/* overrides, kept as text in the parameter file format                       */
+/* list          : The overrides so far, or NULL                              */
+/* arg           : The override to add                                        */
+/* return        : The new list of overrides, or NULL if arg is invalid, in   */
+/*                  which case list is freed                                  */
+/* -------------------------------------------------------------------------- */
+char *add_override(char *list, char *arg) {
+    char *eq = strchr(arg, '=');
+    int len = (list != NULL) ? strlen(list) : 0;
+
+    if (eq == NULL || eq == arg) {
+        free(list);
+        return NULL;
+    }
+    list = (char*) realloc(list, len + strlen(arg) + 3);
+    sprintf(list + len, "%.*s: %s\n", (int) (eq - arg), arg, eq + 1);
+    return list;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Apply command line overrides to parameters set by any initialization type. */
+/* Besides the GA settings, the seed, population size and termination         */
+/* parameters may be overridden.                                              */
+/* text          : The overrides, in the parameter file format; freed here    */
+/* -------------------------------------------------------------------------- */
+void override_params(deme *subpop, char *text) {
+    param_index *idx = parse_params(text);
+
+    if (find_param(idx, "rand_seed:"))
+        subpop->rand_seed = param_value(idx, "rand_seed:");
+    if (find_param(idx, "pop_size:"))
+        subpop->pop_size  = param_value(idx, "pop_size:");
+    if (find_param(idx, "end_type:"))
+        subpop->end_type  = param_value(idx, "end_type:");
+    if (find_param(idx, "end_gen:"))
+        subpop->end_gen   = param_value(idx, "end_gen:");
+    if (find_param(idx, "f_thresh:"))
+        subpop->f_thresh  = param_value(idx, "f_thresh:");
+    if (find_param(idx, "conv_gen:"))
+        subpop->conv_gen  = param_value(idx, "conv_gen:");
+    if (find_param(idx, "conv_var:"))
+        subpop->conv_var  = param_value(idx, "conv_var:");
+    if (find_param(idx, "time_limit:"))
+        subpop->time_limit = param_value(idx, "time_limit:");
+    get_settings(subpop, idx);
+    subpop->islands = island_params(idx, subpop->islands);
+    free_params(idx);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Allocate n_objs obstacles. The obstacles and their centers are each laid   */
+/* out in one contiguous array.                                               */
+/* -------------------------------------------------------------------------- */
+void alloc_objects(deme *subpop) {
+    int i, n = subpop->n_objs > 0 ? subpop->n_objs : 0;
+    object *objs = (object*) malloc(sizeof(object) * n);
+    point *centers = (point*) malloc(sizeof(point) * n);
+
+    subpop->objs = (object**) malloc(sizeof(object*) * n);
+    for (i = 0; i < n; i++) {
+        subpop->objs[i] = &objs[i];
+        subpop->objs[i]->center = &centers[i];
+        subpop->objs[i]->radius = 0;
+        subpop->objs[i]->missing = 0;
+    }
 }
 
 
 /* -------------------------------------------------------------------------- */
 /* Imports program parameters from a file following the format specfied in    */
-/* export_population.                                                         */
+/* export_population. Obstacles are read from the file itself, or from a      */
+/* binary obstacle file if one is named by an obj_file entry.                 */
+/* return        : 0 on success; non-zero if a file could not be read         */
 /* -------------------------------------------------------------------------- */
-void import_population(deme *subpop, char *filename) {
+int import_population(deme *subpop, char *filename) {
     int i;
     char varname1[BUFFER_SIZE];
     char varname2[BUFFER_SIZE];
-    FILE *fp;
+    char *obj_file;
+    param_index *idx;
 
     errno = 0;
-    fp = fopen(filename, "r");
-    if (errno != 0) {
+    idx = read_params(filename);
+    if (idx == NULL) {
         fprintf(stderr, "Error %i: %s\n", errno, strerror(errno));
-        exit(-1);
+        return -1;
     }
 
-    subpop->rand_seed     = get_value(fp, "rand_seed:");
-    subpop->pop_size     = get_value(fp, "pop_size:");
-    subpop->ff_type         = get_value(fp, "ff_type:");
-    subpop->end_type     = get_value(fp, "end_type:");
+    subpop->rand_seed     = param_value(idx, "rand_seed:");
+    subpop->pop_size      = param_value(idx, "pop_size:");
+    subpop->ff_type       = param_value(idx, "ff_type:");
+    subpop->end_type      = param_value(idx, "end_type:");
     if (subpop->end_type == 0)
-        subpop->end_gen     = get_value(fp, "end_gen:");
+        subpop->end_gen  = param_value(idx, "end_gen:");
     else if (subpop->end_type == 1 || subpop->end_type == 2)
-        subpop->f_thresh = get_value(fp, "f_thresh:");
+        subpop->f_thresh = param_value(idx, "f_thresh:");
     else if (subpop->end_type == 3) {
-        subpop->conv_gen = get_value(fp, "conv_gen:");
-        subpop->conv_var = get_value(fp, "conv_var:");
+        subpop->conv_gen = param_value(idx, "conv_gen:");
+        subpop->conv_var = param_value(idx, "conv_var:");
     }
+    else if (subpop->end_type == 4)
+        subpop->time_limit = param_value(idx, "time_limit:");
 
     if (subpop->ff_type == FF_SHPATH) {
-        subpop->s          = get_point(fp, "s:");
-        subpop->t         = get_point(fp, "t:");
-        subpop->n_objs     = get_value(fp, "n_objs:");
-        subpop->objs = (object**) malloc(sizeof(object*) * subpop->n_objs);
-        for (i = 0; i < subpop->n_objs; i++) {
-            sprintf(varname1, "obj_%i_center:", i);
-            sprintf(varname2, "obj_%i_radius:", i);
-            subpop->objs[i] = (object*) malloc(sizeof(object));
-            subpop->objs[i]->center = get_point(fp, varname1);
-            subpop->objs[i]->radius = get_value(fp, varname2);
+        subpop->s = (point*) malloc(sizeof(point));
+        subpop->t = (point*) malloc(sizeof(point));
+        if (!param_point(idx, "s:", subpop->s)) subpop->s->x = SP_BOUND+1;
+        if (!param_point(idx, "t:", subpop->t)) subpop->t->x = SP_BOUND+1;
+
+        obj_file = find_param(idx, "obj_file:");
+        if (obj_file != NULL && read_objects(subpop, obj_file) != 0) {
+            free_params(idx);
+            return -1;
+        }
+        else if (obj_file == NULL) {
+            subpop->n_objs = param_value(idx, "n_objs:");
+            alloc_objects(subpop);
+            for (i = 0; i < subpop->n_objs; i++) {
+                sprintf(varname1, "obj_%i_center:", i);
+                sprintf(varname2, "obj_%i_radius:", i);
+                if (!param_point(idx, varname1, subpop->objs[i]->center))
+                    subpop->objs[i]->missing = 1;
+                subpop->objs[i]->radius = param_value(idx, varname2);
+            }
         }
     }
 
+    get_settings(subpop, idx);
+    subpop->islands = island_params(idx, subpop->islands);
+    free_params(idx);
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Reads obstacles from a binary obstacle file. Format:                       */
+/*        int magic (OBJ_MAGIC)                                               */
+/*        int n_objs                                                          */
+/*        n_objs records of int x, y, z, radius                               */
+/* or, for scenes with obstacles besides spheres:                             */
+/*        int magic (OBJ_MAGIC_SHAPES)                                        */
+/*        int n_objs, n_boxes, n_capsules, n_meshes, n_triangles              */
+/*        n_objs records of int x, y, z, radius                               */
+/*        n_boxes records of int x0, y0, z0, x1, y1, z1 (opposite corners)    */
+/*        n_capsules records of int x0, y0, z0, x1, y1, z1, radius            */
+/*        n_meshes ints, the number of triangles of each mesh                 */
+/*        n_triangles records of int x0, y0, z0, x1, y1, z1, x2, y2, z2, the  */
+/*            triangles of each mesh in turn                                  */
+/* return        : 0 on success; non-zero if the file could not be read       */
+/* -------------------------------------------------------------------------- */
+int read_objects(deme *subpop, char *filename) {
+    int i, hdr[2], n[SHAPE_KINDS] = {0}, n_ints, *objs = NULL, *recs;
+    FILE *fp = fopen(filename, "rb");
+
+    if (fp == NULL || fread(hdr, sizeof(int), 2, fp) != 2
+        || (hdr[0] != OBJ_MAGIC && hdr[0] != OBJ_MAGIC_SHAPES) || hdr[1] < 0
+        || (hdr[0] == OBJ_MAGIC_SHAPES
+            && fread(n, sizeof(int), SHAPE_KINDS, fp) != SHAPE_KINDS)
+        || n[SHAPE_BOXES] < 0 || n[SHAPE_CAPSULES] < 0
+        || n[SHAPE_MESHES] < 0 || n[SHAPE_TRIS] < 0) {
+        fprintf(stderr, "Error: %s is not an obstacle file\n", filename);
+        if (fp != NULL) fclose(fp);
+        return -1;
+    }
+
+    // Every record is read in bulk
+    subpop->n_objs = hdr[1];
+    objs = (int*) malloc(sizeof(int) * 4 * subpop->n_objs);
+    n_ints = shape_ints(n);
+    recs = (int*) malloc(sizeof(int) * n_ints);
+    if (fread(objs, sizeof(int)*4, subpop->n_objs, fp) != subpop->n_objs
+        || fread(recs, sizeof(int), n_ints, fp) != n_ints) {
+        fprintf(stderr, "Error: %s is truncated\n", filename);
+        fclose(fp);
+        free(objs);
+        free(recs);
+        return -1;
+    }
+    fclose(fp);
+    subpop->shapes = shapes_create(n, recs);
+
+    alloc_objects(subpop);
+    for (i = 0; i < subpop->n_objs; i++) {
+        subpop->objs[i]->center->x = objs[4*i];
+        subpop->objs[i]->center->y = objs[4*i+1];
+        subpop->objs[i]->center->z = objs[4*i+2];
+        subpop->objs[i]->radius    = objs[4*i+3];
+    }
+    free(objs);
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Writes obstacles to a binary obstacle file, as read by read_objects. The   */
+/* second format is only used for scenes with obstacles besides spheres.      */
+/* return        : 0 on success; non-zero if the file could not be written    */
+/* -------------------------------------------------------------------------- */
+int write_objects(deme *subpop, char *filename) {
+    int i, hdr[2] = {OBJ_MAGIC, subpop->n_objs}, n[SHAPE_KINDS];
+    int *objs = (int*) malloc(sizeof(int) * 4 * subpop->n_objs);
+    int *recs = shape_records(subpop->shapes, n);
+    FILE *fp;
+
+    errno = 0;
+    fp = fopen(filename, "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "Error %i: %s\n", errno, strerror(errno));
+        free(objs);
+        return -1;
+    }
+
+    for (i = 0; i < subpop->n_objs; i++) {
+        objs[4*i]   = subpop->objs[i]->center->x;
+        objs[4*i+1] = subpop->objs[i]->center->y;
+        objs[4*i+2] = subpop->objs[i]->center->z;
+        objs[4*i+3] = subpop->objs[i]->radius;
+    }
+    if (recs != NULL) hdr[0] = OBJ_MAGIC_SHAPES;
+    fwrite(hdr, sizeof(int), 2, fp);
+    if (recs != NULL) fwrite(n, sizeof(int), SHAPE_KINDS, fp);
+    fwrite(objs, sizeof(int)*4, subpop->n_objs, fp);
+    if (recs != NULL) fwrite(recs, sizeof(int), shape_ints(n), fp);
     fclose(fp);
+    free(objs);
+    return 0;
 }
 
 
@@ -157,6 +912,7 @@ void import_population(deme *subpop, char *filename) {
 /*        *f_thresh: <value>                                                  */
 /*        *conv_gen: <value>                                                  */
 /*        *conv_var: <value>                                                  */
+/*        *time_limit: <value>                                                */
 /*        *s: <values>                                                        */
 /*        *t: <values>                                                        */
 /*        *n_objs: <value>                                                    */
@@ -165,18 +921,25 @@ void import_population(deme *subpop, char *filename) {
 /*        *...                                                                */
 /*        *obj_n_center: <values>                                             */
 /*        *obj_n_radius: <value>                                              */
+/*        *obj_file: <filename>                                               */
 /*                                                                            */
 /*        * = optional, depending on other settings                           */
+/*                                                                            */
+/* Scenes with more than EXPORT_OBJS_MAX obstacles, or with obstacles besides */
+/* spheres, are written to a binary obstacle file <filename>.obj, which is    */
+/* named by obj_file instead of listing each obstacle.                        */
+/* return        : 0 on success; non-zero if a file could not be written      */
 /* -------------------------------------------------------------------------- */
-void export_population(deme *subpop, char *filename) {
-    int i;
+int export_population(deme *subpop, char *filename) {
+    int i, err = 0;
+    char obj_file[strlen(filename) + 5];
     FILE *fp;
 
     errno = 0;
     fp = fopen(filename, "w");
-    if (errno != 0) {
+    if (fp == NULL) {
         fprintf(stderr, "Error %i: %s\n", errno, strerror(errno));
-        exit(-1);
+        return -1;
     }
 
     fprintf(fp, "#File %s generated by ga/init\n", filename);
@@ -194,23 +957,70 @@ void export_population(deme *subpop, char *filename) {
         fprintf(fp, "conv_gen: %i\n", subpop->conv_gen);
         fprintf(fp, "conv_var: %.1f\n", subpop->conv_var);
     }
+    else if(subpop->end_type == M_WALL_CLOCK)
+        fprintf(fp, "time_limit: %.1f\n", subpop->time_limit);
+
+    fprintf(fp, "\ncrossover_rate: %g\n", subpop->cfg.xover_rate);
+    fprintf(fp, "mutation_rate: %g\n", subpop->cfg.mut_rate);
+    fprintf(fp, "selection: %i\n", subpop->cfg.selection);
+    fprintf(fp, "tourn_size: %i\n", subpop->cfg.tourn_size);
+    fprintf(fp, "crossover: %i\n", subpop->cfg.crossover);
+    fprintf(fp, "surr_frac: %g\n", subpop->cfg.surr_frac);
+    fprintf(fp, "surr_k: %i\n", subpop->cfg.surr_k);
+    fprintf(fp, "restart_gens: %i\n", subpop->cfg.restart_gens);
+    fprintf(fp, "restart_elite: %i\n", subpop->cfg.restart_elite);
+    fprintf(fp, "fused: %i\n", subpop->cfg.fused);
+    fprintf(fp, "numa_alloc: %i\n", subpop->cfg.numa_alloc);
+    fprintf(fp, "huge_pages: %i\n", subpop->cfg.huge_pages);
+    fprintf(fp, "prnt_rate: %i\n", subpop->cfg.prnt_rate);
+    fprintf(fp, "prnt_data: %i\n", subpop->cfg.prnt_data);
+    fprintf(fp, "prnt_stat: %i\n", subpop->cfg.prnt_stat);
+    fprintf(fp, "prnt_chrs: %i\n", subpop->cfg.prnt_chrs);
+    fprintf(fp, "prnt_info: %i\n", subpop->cfg.prnt_info);
+    fprintf(fp, "prnt_fits: %i\n", subpop->cfg.prnt_fits);
+    for (i = 0; i < subpop->cfg.n_targets; i++)
+        fprintf(fp, "%s%g", i == 0 ? "targets: " : ",",
+            subpop->cfg.targets[i]);
+    if (subpop->cfg.n_targets > 0) fprintf(fp, "\n");
 
     if (subpop->ff_type == FF_SHPATH) {
+        fprintf(fp, "\nn_points: %i\n", subpop->cfg.n_points);
+        fprintf(fp, "n_points_start: %i\n", subpop->cfg.n_points_start);
+        fprintf(fp, "res_gens: %i\n", subpop->cfg.res_gens);
+        fprintf(fp, "coord_size: %i\n", subpop->cfg.coord_size);
+        fprintf(fp, "collision_cost: %g\n", subpop->cfg.coll_cost);
+        fprintf(fp, "genome: %i\n", subpop->cfg.genome);
+        fprintf(fp, "mut_sigma: %g\n", subpop->cfg.mut_sigma);
+        fprintf(fp, "ls_top: %i\n", subpop->cfg.ls_top);
+        fprintf(fp, "ls_probes: %i\n", subpop->cfg.ls_probes);
+        fprintf(fp, "ls_step: %i\n", subpop->cfg.ls_step);
+        fprintf(fp, "seed_line: %g\n", subpop->cfg.seed_line);
+        fprintf(fp, "seed_detour: %g\n", subpop->cfg.seed_detour);
+        fprintf(fp, "seed_jitter: %i\n", subpop->cfg.seed_jitter);
         fprintf(fp, "s: (%i,%i,%i)\n", subpop->s->x,subpop->s->y,subpop->s->z);
         fprintf(fp, "t: (%i,%i,%i)\n", subpop->t->x,subpop->t->y,subpop->t->z);
-        fprintf(fp, "\nn_objs: %i\n", subpop->n_objs);
-        for (i = 0; i < subpop->n_objs; i++) {
-            fprintf(fp, "obj_%i_center: (%i,%i,%i)\n", i,
-                    subpop->objs[i]->center->x,
-                    subpop->objs[i]->center->y,
-                    subpop->objs[i]->center->z);
-            fprintf(fp, "obj_%i_radius: %i\n", i, subpop->objs[i]->radius);
+        if (subpop->n_objs > EXPORT_OBJS_MAX || subpop->shapes != NULL) {
+            sprintf(obj_file, "%s.obj", filename);
+            err = write_objects(subpop, obj_file);
+            fprintf(fp, "\nobj_file: %s\n", obj_file);
+        }
+        else {
+            fprintf(fp, "\nn_objs: %i\n", subpop->n_objs);
+            for (i = 0; i < subpop->n_objs; i++) {
+                fprintf(fp, "obj_%i_center: (%i,%i,%i)\n", i,
+                        subpop->objs[i]->center->x,
+                        subpop->objs[i]->center->y,
+                        subpop->objs[i]->center->z);
+                fprintf(fp, "obj_%i_radius: %i\n", i,
+                        subpop->objs[i]->radius);
+            }
         }
     }
+    if (subpop->islands != NULL) fprintf(fp, "\n%s", subpop->islands);
 
-    printf("File %s successfully written\n", filename);
+    if (err == 0) printf("File %s successfully written\n", filename);
     fclose(fp);
-    exit(1);
+    return err;
 }
 
 
@@ -226,7 +1036,7 @@ void get_input(deme *subpop) {
     printf("Enter fitness function type (0-1): ");
     subpop->ff_type = get_value(stdin, NULL);
 
-    printf("Enter termination type (0-3): ");
+    printf("Enter termination type (0-4): ");
     subpop->end_type = get_value(stdin, NULL);
 
     if (subpop->end_type == 0) {
@@ -244,25 +1054,32 @@ void get_input(deme *subpop) {
         printf("Enter convergence variation: ");
         subpop->conv_var = get_value(stdin, NULL);
     }
+    else if (subpop->end_type == 4) {
+        printf("Enter time limit in seconds: ");
+        subpop->time_limit = get_value(stdin, NULL);
+    }
 
     printf("Enter RNG seed (0 to generate one): ");
     subpop->rand_seed = get_value(stdin, NULL);
 
     if (subpop->ff_type == FF_SHPATH) {
+        subpop->s = (point*) malloc(sizeof(point));
+        subpop->t = (point*) malloc(sizeof(point));
+
         printf("Enter starting point in the format (x,y,z): ");
-        subpop->s = get_point(stdin, NULL);
+        if (!get_point(stdin, NULL, subpop->s)) subpop->s->x = SP_BOUND+1;
 
         printf("Enter end point in the format (x,y,z): ");
-        subpop->t = get_point(stdin, NULL);
+        if (!get_point(stdin, NULL, subpop->t)) subpop->t->x = SP_BOUND+1;
 
         printf("Enter number of objects ");
         subpop->n_objs = get_value(stdin, NULL);
-        subpop->objs = (object**) malloc(sizeof(object*) * subpop->n_objs);
+        alloc_objects(subpop);
 
         for (i = 0; i < subpop->n_objs; i++) {
-            subpop->objs[i] = (object*) malloc(sizeof(object));
             printf("Enter object %i center in the format (x,y,z): ", i);
-            subpop->objs[i]->center = get_point(stdin, NULL);
+            if (!get_point(stdin, NULL, subpop->objs[i]->center))
+                subpop->objs[i]->missing = 1;
 
             printf("Enter object %i radius: ", i);
             subpop->objs[i]->radius = get_value(stdin, NULL);
@@ -273,8 +1090,9 @@ void get_input(deme *subpop) {
 
 /* -------------------------------------------------------------------------- */
 /* Validate input received from user or read from input file                  */
+/* return        : Non-zero if any input is invalid                           */
 /* -------------------------------------------------------------------------- */
-void test_input(deme* subpop) {
+int test_input(deme* subpop) {
     int i, is_invalid = 0;
 
     if (subpop->pop_size < 1) {
@@ -289,7 +1107,7 @@ void test_input(deme* subpop) {
         is_invalid = 1;
     }
 
-    if (subpop->end_type < 0 || subpop->end_type > 3) {
+    if (subpop->end_type < 0 || subpop->end_type > 4) {
         fprintf(stderr, "Error: Invalid value for termination type\n");
         is_invalid = 1;
     }
@@ -308,8 +1126,98 @@ void test_input(deme* subpop) {
         fprintf(stderr, "Error: Invalid convergence values\n");
         is_invalid = 1;
     }
+    else if (subpop->end_type == 4 && subpop->time_limit <= 0) {
+        fprintf(stderr, "Error: Invalid value for time limit\n");
+        is_invalid = 1;
+    }
+
+    if (subpop->cfg.xover_rate < 0 || subpop->cfg.xover_rate > 1
+        || subpop->cfg.mut_rate < 0 || subpop->cfg.mut_rate > 1) {
+        fprintf(stderr, "Error: Invalid crossover or mutation rate\n");
+        is_invalid = 1;
+    }
+
+    if (subpop->cfg.genome < GENOME_BINARY || subpop->cfg.genome > GENOME_INT
+        || (subpop->cfg.genome == GENOME_INT
+            && (subpop->ff_type != FF_SHPATH || subpop->cfg.surr_frac < 1))
+        || subpop->cfg.mut_sigma <= 0) {
+        fprintf(stderr, "Error: Invalid genome settings\n");
+        is_invalid = 1;
+    }
+
+    if (subpop->cfg.seed_line < 0 || subpop->cfg.seed_detour < 0
+        || subpop->cfg.seed_line + subpop->cfg.seed_detour > 1
+        || subpop->cfg.seed_jitter < 0) {
+        fprintf(stderr, "Error: Invalid seeding settings\n");
+        is_invalid = 1;
+    }
+
+    if (subpop->cfg.surr_frac <= 0 || subpop->cfg.surr_frac > 1
+        || subpop->cfg.surr_k < 1 || subpop->cfg.surr_k > SURR_ARCHIVE) {
+        fprintf(stderr, "Error: Invalid surrogate settings\n");
+        is_invalid = 1;
+    }
+
+    if (subpop->cfg.restart_gens < 0 || subpop->cfg.restart_elite < 0
+        || subpop->cfg.restart_elite > subpop->pop_size) {
+        fprintf(stderr, "Error: Invalid restart settings\n");
+        is_invalid = 1;
+    }
+
+    if (subpop->cfg.selection < SEL_ROULETTE
+        || subpop->cfg.selection > SEL_TOURNAMENT
+        || subpop->cfg.tourn_size < 1
+        || subpop->cfg.tourn_size > subpop->pop_size
+        || subpop->cfg.crossover < XO_MIDPOINT
+        || subpop->cfg.crossover > XO_UNIFORM) {
+        fprintf(stderr, "Error: Invalid operator settings\n");
+        is_invalid = 1;
+    }
+
+    if (subpop->cfg.fused < 0 || subpop->cfg.fused > 1) {
+        fprintf(stderr, "Error: Invalid fused setting\n");
+        is_invalid = 1;
+    }
+
+    if (subpop->cfg.numa_alloc < 0 || subpop->cfg.numa_alloc > 1
+        || subpop->cfg.huge_pages < 0 || subpop->cfg.huge_pages > 2) {
+        fprintf(stderr, "Error: Invalid memory placement settings\n");
+        is_invalid = 1;
+    }
+
+    if (subpop->cfg.n_targets < 0) {
+        fprintf(stderr, "Error: Invalid targets; expected up to %i "
+            "comma-separated values\n", MAX_TARGETS);
+        is_invalid = 1;
+    }
+
+    if (subpop->cfg.prnt_rate < 0) {
+        fprintf(stderr, "Error: Invalid value for report rate\n");
+        is_invalid = 1;
+    }
 
     if (subpop->ff_type == FF_SHPATH) {
+        if (subpop->cfg.n_points < 1) {
+            fprintf(stderr, "Error: Invalid number of path points\n");
+            is_invalid = 1;
+        }
+
+        if (subpop->cfg.n_points_start < 0 || subpop->cfg.res_gens < 1) {
+            fprintf(stderr, "Error: Invalid multi-resolution settings\n");
+            is_invalid = 1;
+        }
+
+        if (subpop->cfg.coord_size < 2 || subpop->cfg.coord_size > 31) {
+            fprintf(stderr, "Error: Invalid coordinate size\n");
+            is_invalid = 1;
+        }
+
+        if (subpop->cfg.ls_top < 0 || subpop->cfg.ls_top > subpop->pop_size
+            || subpop->cfg.ls_probes < 0 || subpop->cfg.ls_step < 1) {
+            fprintf(stderr, "Error: Invalid local search settings\n");
+            is_invalid = 1;
+        }
+
         if (!valid_loc(subpop->s)) {
             fprintf(stderr, "Error: Invalid start point\n");
             is_invalid = 1;
@@ -321,16 +1229,17 @@ void test_input(deme* subpop) {
         }
 
         for (i = 0; i < subpop->n_objs; i++) {
-            if (subpop->objs[i]->center == NULL) {
+            if (subpop->objs[i]->missing) {
                 fprintf(stderr, "Error: No entry for object %i\n",i);
                 is_invalid = 1;
+                continue;
             }
-            else if (!valid_loc(subpop->objs[i]->center)) {
+            if (!valid_loc(subpop->objs[i]->center)) {
                 fprintf(stderr,"Error: Invalid coordinates for object %i\n",i);
                 is_invalid = 1;
             }
 
-            if (subpop->objs[i]->center!=NULL && subpop->objs[i]->radius < 1) {
+            if (subpop->objs[i]->radius < 1) {
                 fprintf(stderr, "Error: Invalid radius for object %i\n",i);
                 is_invalid = 1;
             }
@@ -347,9 +1256,11 @@ void test_input(deme* subpop) {
                 is_invalid = 1;
             }
         }
+
+        if (test_shapes(subpop)) is_invalid = 1;
     }
 
-    if (is_invalid) usage2();
+    return is_invalid;
 }
 
 
@@ -379,16 +1290,17 @@ double get_value(FILE *fp, char *varname) {
 
 
 /* -------------------------------------------------------------------------- */
-/* Make a new point structure from a string in the format "(x,y,z)".          */
-/* If a string is incorrectly formatted, 0s are used as coordinates           */
+/* Get a point from the specified file in the format "(x,y,z)". If it is      */
+/* incorrectly formatted, coordinates outside of SP_BOUND are used.           */
 /* fp            : A pointer to the stream being read                         */
-/* s            : The label of the coordinates to look for                    */
+/* varname       : The label of the coordinates to look for                   */
+/* p             : Receives the point                                         */
+/* return        : 1 if a point was read; 0 otherwise                         */
 /* -------------------------------------------------------------------------- */
-point *get_point(FILE *fp, char *varname) {
+int get_point(FILE *fp, char *varname, point *p) {
     int status;
     char str[BUFFER_SIZE];
     char *x_str, *y_str, *z_str;
-    point *p = (point*) malloc(sizeof(point));
 
     if (varname != NULL) {
         rewind(fp);
@@ -396,8 +1308,7 @@ point *get_point(FILE *fp, char *varname) {
         while (!feof(fp) && strcmp(str, varname) != 0);
     }
 
-    if        (!feof(fp)) status = fscanf(fp, "%s", str);
-    else    return NULL;
+    if (feof(fp) || fscanf(fp, "%s", str) != 1) return 0;
 
     x_str = strtok(str,  "( ,)");
     y_str = strtok(NULL, "( ,)");
@@ -407,6 +1318,6 @@ point *get_point(FILE *fp, char *varname) {
     if (y_str != NULL) p->y = atoi(y_str);     else p->y = SP_BOUND+1;
     if (z_str != NULL) p->z = atoi(z_str);     else p->z = SP_BOUND+1;
 
-    return p;
+    return 1;
 }
 
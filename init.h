@@ -1,14 +1,37 @@
 #ifndef INIT_H_
 #define INIT_H_
+#include "params.h"
 #include "types.h"
 
-void    init_population(deme*, int, char**);
-void    import_population(deme*, char*);
-void    export_population(deme*, char*);
+#define OBJ_MAGIC           0x47414f42  // "GAOB"
+#define OBJ_MAGIC_SHAPES    0x47414f53  // "GAOS", with boxes, capsules, meshes
+
+// Results of init_population
+#define INIT_OK             0       // The run is ready to start
+#define INIT_EXPORTED       1       // Parameters were exported; nothing to run
+#define INIT_FAILED         -1      // The run cannot start
+
+int     init_population(deme*, MPI_Comm, int, char**);
+void    init_topology(deme*);
+void    alloc_population(deme*);
+void    free_population(deme*);
+void    release_params(deme*);
+void    init_ring(deme*, ring*, MPI_Comm);
+char    *shared_outbox(deme*, int);
+void    share_params(deme*);
+void    default_settings(settings*);
+void    get_settings(deme*, param_index*);
+char    *add_override(char*, char*);
+void    override_params(deme*, char*);
+void    alloc_objects(deme*);
+int     import_population(deme*, char*);
+int     read_objects(deme*, char*);
+int     write_objects(deme*, char*);
+int     export_population(deme*, char*);
 void    get_input(deme*);
-void    test_input(deme*);
+int     test_input(deme*);
 double  get_value(FILE*, char*);
-point   *get_point(FILE*, char*);
+int     get_point(FILE*, char*, point*);
 
 #endif
 
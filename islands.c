@@ -0,0 +1,233 @@
+/* ========================================================================== */
+/* Heterogeneous islands. Instead of every deme running the same search, the  */
+/* parameter file may give the demes of a range of processes their own        */
+/* operators and rates, so one run is a portfolio of strategies connected by  */
+/* migration. An entry "island_4-7_mutation_rate: 0.2" sets mutation_rate for */
+/* the demes of processes 4 to 7, and "island_3_selection: 1" sets selection  */
+/* for process 3 alone. Where ranges overlap, a deme takes each setting from  */
+/* the narrowest range that covers it. At the end of the run, the demes with  */
+/* the same settings are reported together, along with the settings of the    */
+/* deme that found the best member.                                           */
+/* ========================================================================== */
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "init.h"
+#include "islands.h"
+#include "params.h"
+#include "types.h"
+
+// Settings that may differ between demes without the processes disagreeing
+// on chromosome sizes or on which collective calls to make
+static char *island_keys[] = {
+    "crossover_rate:", "mutation_rate:", "selection:", "tourn_size:",
+    "crossover:", "ls_top:", "ls_probes:", "ls_step:", "seed_line:",
+    "seed_detour:", "seed_jitter:", "mut_sigma:", "restart_elite:", "fused:"
+};
+
+
+/* -------------------------------------------------------------------------- */
+/* Add the island entries of a parameter index to a list of island entries.   */
+/* The new entries are put first, so they take precedence over the list's     */
+/* entries for the same range, e.g. when the list is read from the parameter  */
+/* file and the index holds command line overrides.                           */
+/* list          : Island entries in the parameter file format, or NULL;      */
+/*                  freed here if a new list is made                          */
+/* return        : The new list of entries; NULL if there are none            */
+/* -------------------------------------------------------------------------- */
+char *island_params(param_index *idx, char *list) {
+    int i, len = 0, size = 0;
+    char *text;
+
+    for (i = 0; i < idx->n; i++) {
+        if (strncmp(idx->entries[i].key, "island_", 7) == 0)
+            size += strlen(idx->entries[i].key)
+                + strlen(idx->entries[i].value) + 2;
+    }
+    if (size == 0) return list;
+    size += (list != NULL) ? strlen(list) + 1 : 1;
+
+    text = (char*) malloc(size);
+    for (i = 0; i < idx->n; i++) {
+        if (strncmp(idx->entries[i].key, "island_", 7) == 0)
+            len += sprintf(text + len, "%s %s\n", idx->entries[i].key,
+                idx->entries[i].value);
+    }
+    strcpy(text + len, (list != NULL) ? list : "");
+    free(list);
+    return text;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Split an island key into the range of processes it applies to and the key  */
+/* of the setting                                                             */
+/* key           : The key, e.g. "island_4-7_mutation_rate:"                  */
+/* first, last   : Receive the first and last process of the range            */
+/* name          : Receives the key of the setting, e.g. "mutation_rate:"     */
+/* return        : 1 if key is a valid island key; 0 otherwise                */
+/* -------------------------------------------------------------------------- */
+int parse_island(char *key, int *first, int *last, char **name) {
+    int i, n = 0, m = 0;
+    int n_keys = sizeof(island_keys) / sizeof(island_keys[0]);
+
+    if (sscanf(key, "island_%d%n", first, &n) != 1 || n == 0) return 0;
+    *last = *first;
+    if (key[n] == '-') {
+        if (sscanf(key + n + 1, "%d%n", last, &m) != 1) return 0;
+        n += m + 1;
+    }
+    if (key[n] != '_' || *first < 0 || *last < *first) return 0;
+
+    *name = key + n + 1;
+    for (i = 0; i < n_keys; i++)
+        if (strcmp(*name, island_keys[i]) == 0) return 1;
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Find the island settings of one process, each from the narrowest range     */
+/* that covers the process, and from the first such entry on a tie            */
+/* rank          : The process                                                */
+/* return        : The settings in the parameter file format, without the     */
+/*                  island prefix; empty if the process has none              */
+/* -------------------------------------------------------------------------- */
+char *island_entries(deme *subpop, int rank) {
+    int i, j, k, len = 0, size = 1, n = 0, first, last;
+    param_index *idx = parse_params(strdup(subpop->islands));
+    int width[idx->n > 0 ? idx->n : 1];
+    param *match[idx->n > 0 ? idx->n : 1];
+    char *name[idx->n > 0 ? idx->n : 1], *key, *text;
+
+    // Keep the matching entries ordered by width, then by file position
+    for (i = 0; i < idx->n; i++) {
+        if (!parse_island(idx->entries[i].key, &first, &last, &key)
+            || rank < first || rank > last) continue;
+        for (j = n++; j > 0 && (last - first < width[j-1]
+             || (last - first == width[j-1]
+                 && idx->entries[i].pos < match[j-1]->pos)); j--) {
+            width[j] = width[j-1];
+            match[j] = match[j-1];
+            name[j] = name[j-1];
+        }
+        width[j] = last - first;
+        match[j] = &idx->entries[i];
+        name[j] = key;
+        size += strlen(key) + strlen(match[j]->value) + 2;
+    }
+
+    text = (char*) malloc(size);
+    text[0] = '\0';
+    for (i = 0; i < n; i++) {
+        for (k = 0; k < i && strcmp(name[k], name[i]) != 0; k++);
+        if (k == i)
+            len += sprintf(text + len, "%s %s\n", name[i], match[i]->value);
+    }
+    free_params(idx);
+    return text;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Apply the island settings of one process to the GA settings of a deme      */
+/* rank          : The process                                                */
+/* -------------------------------------------------------------------------- */
+void island_settings(deme *subpop, int rank) {
+    param_index *idx;
+    if (subpop->islands == NULL) return;
+
+    idx = parse_params(island_entries(subpop, rank));
+    get_settings(subpop, idx);
+    free_params(idx);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Check that every island key is valid, and that the settings of every       */
+/* process are valid with its island settings applied                         */
+/* return        : 1 if any are invalid; 0 otherwise                          */
+/* -------------------------------------------------------------------------- */
+int test_islands(deme *subpop) {
+    int i, r, n_procs, first, last, is_invalid = 0;
+    char *name;
+    settings cfg = subpop->cfg;
+    param_index *idx;
+
+    if (subpop->islands == NULL) return 0;
+    idx = parse_params(strdup(subpop->islands));
+    for (i = 0; i < idx->n; i++) {
+        if (!parse_island(idx->entries[i].key, &first, &last, &name)) {
+            fprintf(stderr, "Error: Invalid island setting %s\n",
+                idx->entries[i].key);
+            is_invalid = 1;
+        }
+    }
+    free_params(idx);
+    if (is_invalid) return 1;
+
+    MPI_Comm_size(subpop->comm, &n_procs);
+    for (r = 0; r < n_procs && !is_invalid; r++) {
+        island_settings(subpop, r);
+        if (test_input(subpop)) {
+            fprintf(stderr, "Error: Invalid island settings for process %i\n",
+                r);
+            is_invalid = 1;
+        }
+        subpop->cfg = cfg;
+    }
+    return is_invalid;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Print the best and mean fitness of the demes of each distinct set of       */
+/* island settings, and which of them produced the best member of the run     */
+/* -------------------------------------------------------------------------- */
+void island_report(deme *subpop) {
+    int i, j, n_procs, best = 0, group, n_groups = 0;
+    double fit = subpop->old_pop[subpop->fit_max]->fitness, *fits = NULL;
+    double max, sum;
+    char **entries, *c;
+
+    if (subpop->islands == NULL) return;
+    MPI_Comm_size(subpop->comm, &n_procs);
+    if (subpop->rank == 0) fits = (double*) malloc(sizeof(double) * n_procs);
+    MPI_Gather(&fit, 1, MPI_DOUBLE, fits, 1, MPI_DOUBLE, 0, subpop->comm);
+    if (subpop->rank != 0) return;
+
+    entries = (char**) malloc(sizeof(char*) * n_procs);
+    for (i = 0; i < n_procs; i++) {
+        entries[i] = island_entries(subpop, i);
+        for (c = entries[i]; *c != '\0'; c++) if (*c == '\n') *c = ' ';
+        if (c > entries[i]) c[-1] = '\0';
+        if (fits[i] > fits[best]) best = i;
+    }
+
+    // Islands are numbered in order of their first process
+    for (i = 0; i < n_procs; i++) {
+        for (j = 0; j < i && strcmp(entries[j], entries[i]) != 0; j++);
+        if (j < i) continue;
+
+        group = 0;
+        max = sum = 0;
+        for (j = i; j < n_procs; j++) {
+            if (strcmp(entries[j], entries[i]) != 0) continue;
+            if (group == 0 || fits[j] > max) max = fits[j];
+            sum += fits[j];
+            group++;
+        }
+        printf("Island %i (%i demes): best %.0f, mean %.0f; %s\n", n_groups,
+            group, max, sum / group,
+            (*entries[i] != '\0') ? entries[i] : "base settings");
+        if (strcmp(entries[best], entries[i]) == 0)
+            printf("Best member found by island %i, deme %i\n", n_groups, best);
+        n_groups++;
+    }
+
+    for (i = 0; i < n_procs; i++) free(entries[i]);
+    free(entries);
+    free(fits);
+}
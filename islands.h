@@ -0,0 +1,13 @@
+#ifndef ISLANDS_H_
+#define ISLANDS_H_
+#include "params.h"
+#include "types.h"
+
+char    *island_params(param_index*, char*);
+int     parse_island(char*, int*, int*, char**);
+char    *island_entries(deme*, int);
+void    island_settings(deme*, int);
+int     test_islands(deme*);
+void    island_report(deme*);
+
+#endif
@@ -0,0 +1,205 @@
+/* ========================================================================== */
+/* Library interface to the GA, for running it within another program. A run  */
+/* is held by a context, created on a communicator of the calling program's   */
+/* choice, and can be stepped one generation at a time, e.g. to inspect its   */
+/* best member between generations, or run to completion. Every function      */
+/* must be called by all processes of the context's communicator.             */
+/* ========================================================================== */
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "checkpoint.h"
+#include "fitness.h"
+#include "ga.h"
+#include "init.h"
+#include "islands.h"
+#include "libga.h"
+#include "memetic.h"
+#include "multires.h"
+#include "profile.h"
+#include "report.h"
+#include "runlog.h"
+#include "snapshot.h"
+#include "stagnation.h"
+#include "surrogate.h"
+#include "types.h"
+
+
+/* -------------------------------------------------------------------------- */
+/* A run of the GA                                                            */
+/* subpop       : This process's sub-population, which also holds the run's   */
+/*                  communicator, rank and random number stream               */
+/* start_time   : The time at which the main loop started                     */
+/* elapsed      : The time the main loop took; 0 until the run is complete    */
+/* -------------------------------------------------------------------------- */
+struct ga_context {
+    deme        *subpop;
+    double      start_time;
+    double      elapsed;
+};
+
+
+/* -------------------------------------------------------------------------- */
+/* Create a run of the GA on the processes of a communicator                  */
+/* comm          : The communicator of the processes taking part in the run;  */
+/*                  it must remain valid until the run is destroyed           */
+/* argc, argv    : The command line of the run, as for ga itself; argv[0] is  */
+/*                  not used                                                  */
+/* return        : The new run, with its starting population evaluated; NULL, */
+/*                  on all processes, if the command line, parameters or any  */
+/*                  file read are invalid, memory runs out, or the command    */
+/*                  line only exports parameters                              */
+/* -------------------------------------------------------------------------- */
+ga_context *ga_create(MPI_Comm comm, int argc, char *argv[]) {
+    ga_context *ga = (ga_context*) malloc(sizeof(ga_context));
+    deme *subpop = (deme*) malloc(sizeof(deme));
+    int ok = (ga != NULL && subpop != NULL);
+
+    // Every process takes part in init_population, or none does
+    MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+    if (!ok || init_population(subpop, comm, argc, argv) != INIT_OK) {
+        free(subpop);
+        free(ga);
+        return NULL;
+    }
+    ga->subpop = subpop;
+    ga->start_time = MPI_Wtime() - subpop->prior_time;
+    ga->elapsed = 0;
+    subpop->start_time = ga->start_time;
+    check_targets(subpop);
+    profile_start(subpop);
+    return ga;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Run one generation. Once the run completes, its last checkpoint is         */
+/* finished and its snapshot, if any, is written.                             */
+/* return        : Non-zero if the run is complete                            */
+/* -------------------------------------------------------------------------- */
+int ga_step(ga_context *ga) {
+    deme *subpop = ga->subpop;
+    if (subpop->complete) return 1;
+
+    migration(subpop);
+    profile_lap(subpop, PH_MIGRATION);
+    if (subpop->cfg.fused && subpop->surr == NULL) fused_offspring(subpop);
+    else {
+        reproduction(subpop);
+        profile_lap(subpop, PH_REPRODUCTION);
+        crossover(subpop);
+        profile_lap(subpop, PH_CROSSOVER);
+        mutation(subpop);
+        profile_lap(subpop, PH_MUTATION);
+        screen(subpop);
+        fitness(subpop);
+        train_surrogate(subpop);
+    }
+    subpop->old_pop = subpop->new_pop;
+    profile_lap(subpop, PH_FITNESS);
+    local_search(subpop);
+    refine_resolution(subpop);
+    check_stagnation(subpop);
+    subpop->cur_gen++;
+    check_targets(subpop);
+    profile_lap(subpop, PH_LOCAL_SEARCH);
+    check_complete(subpop);
+    sync_complete(subpop);
+    profile_lap(subpop, PH_SYNC);
+    report_all(subpop);
+    profile_lap(subpop, PH_REPORT);
+    checkpoint(subpop);
+    profile_lap(subpop, PH_CHECKPOINT);
+
+    if (subpop->complete) {
+        finish_checkpoint(subpop);
+        ga->elapsed = MPI_Wtime() - ga->start_time;
+        if (subpop->snap_file != NULL)
+            write_snapshot(subpop, subpop->snap_file);
+    }
+    return subpop->complete;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Run generations until the run is complete                                  */
+/* -------------------------------------------------------------------------- */
+void ga_run(ga_context *ga) {
+    while (!ga_step(ga));
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Find the most fit member of all sub-populations of the run                 */
+/* chr           : Receives the member's chromosome, followed by '\0'; must   */
+/*                  hold ga_chr_size() + 1 chars. May be NULL.                */
+/* return        : The member's fitness                                       */
+/* -------------------------------------------------------------------------- */
+double ga_best(ga_context *ga, char *chr) {
+    deme *subpop = ga->subpop;
+    org *best = subpop->old_pop[subpop->fit_max];
+    struct { double fitness; int rank; } local, global;
+
+    local.fitness = best->fitness;
+    local.rank = subpop->rank;
+    MPI_Allreduce(&local, &global, 1, MPI_DOUBLE_INT, MPI_MAXLOC,
+        subpop->comm);
+
+    if (chr != NULL) {
+        if (subpop->rank == global.rank)
+            memcpy(chr, best->chr, subpop->chr_size);
+        MPI_Bcast(chr, subpop->chr_size, MPI_CHAR, global.rank, subpop->comm);
+        chr[subpop->chr_size] = '\0';
+    }
+    return global.fitness;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Find the current chromosome size of the run, which grows as a              */
+/* multi-resolution run refines its paths                                     */
+/* -------------------------------------------------------------------------- */
+int ga_chr_size(ga_context *ga) {
+    return ga->subpop->chr_size;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Find the number of generations run so far                                  */
+/* -------------------------------------------------------------------------- */
+int ga_generation(ga_context *ga) {
+    return ga->subpop->cur_gen;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Print the final reports of a run: its profile, the most fit member, the    */
+/* fitness targets reached, the surrogate's accuracy, the number of restarts  */
+/* of stagnant demes and the elapsed time                                     */
+/* -------------------------------------------------------------------------- */
+void ga_report(ga_context *ga) {
+    deme *subpop = ga->subpop;
+    double elapsed = ga->elapsed;
+
+    if (!subpop->complete) elapsed = MPI_Wtime() - ga->start_time;
+    profile_report(subpop, elapsed);
+    report_fittest(subpop);
+    report_targets(subpop, elapsed);
+    surrogate_report(subpop);
+    restart_report(subpop);
+    island_report(subpop);
+    printf("[%i] Elapsed time: %f\n", subpop->rank, elapsed);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Release a run, finishing its checkpoint and run log                        */
+/* -------------------------------------------------------------------------- */
+void ga_destroy(ga_context *ga) {
+    finish_checkpoint(ga->subpop);
+    runlog_close(ga->subpop);
+    free_population(ga->subpop);
+    free(ga->subpop);
+    free(ga);
+}
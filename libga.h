@@ -0,0 +1,16 @@
+#ifndef LIBGA_H_
+#define LIBGA_H_
+#include <mpi.h>
+
+typedef struct ga_context ga_context;
+
+ga_context  *ga_create(MPI_Comm, int, char**);
+int          ga_step(ga_context*);
+void         ga_run(ga_context*);
+double       ga_best(ga_context*, char*);
+int          ga_chr_size(ga_context*);
+int          ga_generation(ga_context*);
+void         ga_report(ga_context*);
+void         ga_destroy(ga_context*);
+
+#endif
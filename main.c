@@ -0,0 +1,187 @@
+/* ========================================================================= */
+/* Command line entry point, and batch mode, which runs many instances in    */
+/* one MPI job                                                               */
+/* ========================================================================= */
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "init.h"
+#include "libga.h"
+#include "report.h"
+#include "types.h"
+
+int     run_ga(MPI_Comm, int, char**);
+int     run_batch(int, char**);
+int     next_instance(MPI_Comm, MPI_Win);
+
+
+int main(int argc, char *argv[]) {
+    int thread_level, err;
+
+    // Only the main thread makes MPI calls; the run log writes from another
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_level);
+    if (argc >= 3 && strcmp(argv[1], "-b") == 0) err = run_batch(argc, argv);
+    else err = run_ga(MPI_COMM_WORLD, argc, argv);
+    MPI_Finalize();
+    return err ? -1 : 1;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Run the GA once on the processes of a communicator                        */
+/* comm         : The communicator of the processes taking part in the run   */
+/* argc, argv   : The command line of the run, as for ga itself              */
+/* return       : Non-zero if the run could not be created, or its           */
+/*                parameters could not be exported                           */
+/* ------------------------------------------------------------------------- */
+int run_ga(MPI_Comm comm, int argc, char *argv[]) {
+    ga_context *ga;
+    deme subpop;
+
+    // Exporting parameters does not create a run
+    if (argc >= 3 && (strcmp(argv[1], "-de") == 0
+        || strcmp(argv[1], "-ue") == 0))
+        return init_population(&subpop, comm, argc, argv) != INIT_EXPORTED;
+
+    ga = ga_create(comm, argc, argv);
+    if (ga == NULL) return 1;
+    ga_run(ga);
+    ga_report(ga);
+    ga_destroy(ga);
+    return 0;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Run every instance listed in a manifest. MPI_COMM_WORLD is split into     */
+/* groups of group_size processes, and each group runs one instance at a     */
+/* time. Instances are handed out through a shared counter on process 0, so  */
+/* a group that finishes early takes the next one instead of waiting.        */
+/*                                                                           */
+/* Usage: ga -b MANIFEST [-g GROUP_SIZE]                                     */
+/* Each line of the manifest is a parameter file, optionally followed by     */
+/* options for that instance, as for ga -i. Blank lines and lines starting   */
+/* with # are skipped. An instance that cannot be created is reported and    */
+/* skipped, and the others still run.                                        */
+/* return       : Non-zero if the batch could not be run, or any of its      */
+/*                instances could not be created                             */
+/* ------------------------------------------------------------------------- */
+int run_batch(int argc, char *argv[]) {
+    int i, my_rank, group_rank, n_procs, len = 0, n_lines = 0, n_args;
+    int group_size = BATCH_GROUP_SIZE, *counter, inst, err = 0;
+    char *text = NULL, **lines, *line, *args[BUFFER_SIZE];
+    FILE *fp;
+    MPI_Comm group;
+    MPI_Win win;
+    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &n_procs);
+
+    for (i = 3; i < argc && !err; i += 2) {
+        if (i+1 < argc && strcmp(argv[i], "-g") == 0)
+            group_size = atoi(argv[i+1]);
+        else err = 1;
+    }
+    if (err || group_size < 1 || group_size > n_procs) {
+        if (my_rank == 0) usage();
+        return 1;
+    }
+
+    // Process 0 reads the manifest and shares it with all other processes
+    if (my_rank == 0) {
+        fp = fopen(argv[2], "rb");
+        if (fp != NULL) {
+            fseek(fp, 0, SEEK_END);
+            len = ftell(fp);
+            rewind(fp);
+            text = (char*) malloc(len + 1);
+            if (fread(text, 1, len, fp) != len) len = -1;
+            fclose(fp);
+        }
+        else len = -1;
+    }
+    MPI_Bcast(&len, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (len < 0) {
+        if (my_rank == 0)
+            fprintf(stderr, "Error: Could not read manifest %s\n", argv[2]);
+        free(text);
+        return 1;
+    }
+    if (my_rank != 0) text = (char*) malloc(len + 1);
+    MPI_Bcast(text, len, MPI_CHAR, 0, MPI_COMM_WORLD);
+    text[len] = '\0';
+
+    lines = (char**) malloc(sizeof(char*) * (len / 2 + 1));
+    for (line = strtok(text, "\n"); line != NULL; line = strtok(NULL, "\n")) {
+        while (*line == ' ' || *line == '\t') line++;
+        if (*line != '\0' && *line != '#' && *line != '\r')
+            lines[n_lines++] = line;
+    }
+
+    // The counter of instances handed out lives in process 0's window
+    MPI_Win_allocate(my_rank == 0 ? sizeof(int) : 0, sizeof(int),
+        MPI_INFO_NULL, MPI_COMM_WORLD, &counter, &win);
+    if (my_rank == 0) *counter = 0;
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    MPI_Comm_split(MPI_COMM_WORLD, my_rank / group_size, my_rank, &group);
+    MPI_Comm_rank(group, &group_rank);
+    if (my_rank == 0)
+        printf("Batch: %i instances on %i groups of up to %i processes\n",
+            n_lines, (n_procs + group_size - 1) / group_size, group_size);
+
+    while ((inst = next_instance(group, win)) < n_lines) {
+        if (group_rank == 0)
+            printf("[Group %03i] Instance %i: %s\n", my_rank / group_size,
+                inst, lines[inst]);
+
+        // Each instance runs as ga -i FILE [OPTIONS]
+        args[0] = argv[0];
+        args[1] = "-i";
+        line = strdup(lines[inst]);
+        n_args = 2;
+        for (args[n_args] = strtok(line, " \t\r"); args[n_args] != NULL
+             && n_args < BUFFER_SIZE - 1; args[n_args] = strtok(NULL, " \t\r"))
+            n_args++;
+        if (n_args < 3) {
+            if (group_rank == 0) usage();
+            err = 1;
+        }
+        else if (run_ga(group, n_args, args) != 0) {
+            if (group_rank == 0)
+                fprintf(stderr, "[Group %03i] Instance %i could not be run\n",
+                    my_rank / group_size, inst);
+            err = 1;
+        }
+        free(line);
+    }
+
+    MPI_Comm_free(&group);
+    MPI_Win_free(&win);
+    free(lines);
+    free(text);
+
+    // Only the groups that failed know it
+    MPI_Allreduce(MPI_IN_PLACE, &err, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    return err;
+}
+
+
+/* ------------------------------------------------------------------------- */
+/* Take the next instance for a group. The group's first process increments  */
+/* the shared counter, and shares the value it fetched with the group.       */
+/* return       : The index of the instance to run next                      */
+/* ------------------------------------------------------------------------- */
+int next_instance(MPI_Comm group, MPI_Win win) {
+    int group_rank, one = 1, inst;
+    MPI_Comm_rank(group, &group_rank);
+
+    if (group_rank == 0) {
+        MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, win);
+        MPI_Fetch_and_op(&one, &inst, MPI_INT, 0, 0, MPI_SUM, win);
+        MPI_Win_unlock(0, win);
+    }
+    MPI_Bcast(&inst, 1, MPI_INT, 0, group);
+    return inst;
+}
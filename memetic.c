@@ -0,0 +1,128 @@
+/* ========================================================================== */
+/* Memetic refinement of shortest paths. After each evaluation, the ls_top    */
+/* most fit members of a population are improved by hill climbing on their    */
+/* decoded waypoints: one coordinate of one waypoint is moved at a time, and  */
+/* the move is kept if it lowers the cost of the path. Since a waypoint only  */
+/* affects the two segments that meet at it, each move is evaluated from the  */
+/* cost of those two segments instead of the whole path.                      */
+/* ========================================================================== */
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "fitness.h"
+#include "ga.h"
+#include "memetic.h"
+#include "shapes.h"
+#include "types.h"
+
+
+/* -------------------------------------------------------------------------- */
+/* Find the cost of one path segment: its length, plus the collision cost     */
+/* for each obstacle it collides with, exactly as in the fitness function     */
+/* -------------------------------------------------------------------------- */
+double segment_cost(deme *subpop, point *a, point *b) {
+    int k, colls = 0;
+
+    for (k = 0; k < subpop->n_objs; k++)
+        if (collision(a, b, subpop->objs[k])) colls++;
+    colls += shape_hits(subpop->shapes, a, b);
+    return pt_dist(a, b) + colls*subpop->cfg.coll_cost;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Refine the ls_top most fit members of the evaluated population, and update */
+/* their fitness and the population's fitness stats. A copy of each member is */
+/* refined, and only replaces it if it is fitter: a member whose fitness was  */
+/* predicted by the surrogate keeps a chromosome that the fitness describes.  */
+/* -------------------------------------------------------------------------- */
+void local_search(deme *subpop) {
+    int i, n = subpop->cfg.ls_top;
+    int top[n > 0 ? n : 1];
+    char *chosen, chr[subpop->chr_size];
+    double fit;
+    org *member;
+
+    if (n == 0 || subpop->ff_type != FF_SHPATH) return;
+
+    chosen = (char*) calloc(subpop->pop_size, 1);
+    fittest_members(subpop, n, top, chosen);
+    free(chosen);
+
+    for (i = 0; i < n; i++) {
+        member = subpop->old_pop[top[i]];
+        memcpy(chr, member->chr, subpop->chr_size);
+        fit = refine_path(subpop, chr);
+        if (fit <= member->fitness) continue;
+
+        memcpy(member->chr, chr, subpop->chr_size);
+        subpop->fit_tot += fit - member->fitness;
+        member->fitness = fit;
+        if (fit > subpop->old_pop[subpop->fit_max]->fitness)
+            subpop->fit_max = top[i];
+    }
+    subpop->fit_avg = subpop->fit_tot / subpop->pop_size;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Hill climb on the waypoints of one path. Each waypoint coordinate is moved */
+/* by +/- step in turn; a pass without any improvement halves the step, and   */
+/* the search ends when the step falls below 1 or after ls_probes moves.      */
+/* Each move counts as 2/(n_points+1) of a fitness evaluation.                */
+/* chr           : The chromosome to refine; receives the refined path        */
+/* return        : The fitness of the refined path                            */
+/* -------------------------------------------------------------------------- */
+double refine_path(deme *subpop, char *chr) {
+    int i, c, dir, old, improved, probes = 0, step = subpop->cfg.ls_step;
+    int n_points = subpop->cfg.n_points;
+    int bound = coord_bound(subpop);
+    double cost = 0, before, after, fit;
+    double seg[n_points+1], seg1, seg2;
+    point path[n_points+2];
+    int *coord;
+
+    decode_path(subpop, chr, path);
+    for (i = 0; i < n_points+1; i++) {
+        seg[i] = segment_cost(subpop, &path[i], &path[i+1]);
+        cost += seg[i];
+    }
+
+    while (step >= 1 && probes < subpop->cfg.ls_probes) {
+        improved = 0;
+        for (i = 1; i < n_points+1 && probes < subpop->cfg.ls_probes; i++) {
+            for (c = 0; c < 3 && probes < subpop->cfg.ls_probes; c++) {
+                coord = (c == 0) ? &path[i].x : (c == 1) ? &path[i].y
+                                              : &path[i].z;
+                old = *coord;
+                for (dir = -1; dir <= 1 && probes < subpop->cfg.ls_probes;
+                     dir += 2) {
+                    if (abs(old + dir*step) > bound) continue;
+                    *coord = old + dir*step;
+                    probes++;
+
+                    // Only the segments ending and starting at i change
+                    seg1 = segment_cost(subpop, &path[i-1], &path[i]);
+                    seg2 = segment_cost(subpop, &path[i], &path[i+1]);
+                    before = seg[i-1] + seg[i];
+                    after = seg1 + seg2;
+                    if (after < before) {
+                        seg[i-1] = seg1;
+                        seg[i] = seg2;
+                        cost += after - before;
+                        old = *coord;
+                        improved = 1;
+                        break;
+                    }
+                    *coord = old;
+                }
+            }
+        }
+        if (!improved) step /= 2;
+    }
+
+    subpop->n_evals += probes * 2.0 / (n_points+1);
+    encode_path(subpop, path, chr);
+    fit = SP_BOUND*40 - cost;
+    return (fit < 0) ? 1 : fit;
+}
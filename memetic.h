@@ -0,0 +1,9 @@
+#ifndef MEMETIC_H_
+#define MEMETIC_H_
+#include "types.h"
+
+double  segment_cost(deme*, point*, point*);
+void    local_search(deme*);
+double  refine_path(deme*, char*);
+
+#endif
@@ -1,6 +1,7 @@
 /* ========================================================================== */
 /* A implementation of the Mersenne Twister algorithm for fast generation     */
-/* of pseudorandom numbers, modified to support multiple parallel streams.    */
+/* of pseudorandom numbers, modified to support multiple parallel streams,    */
+/* each held in an mt_state owned by its user.                                */
 /* It returns random random integers in the range 0 to 2^32-1 with a period   */
 /* of2^19937-1.                                                               */
 /* ========================================================================== */
@@ -47,13 +48,10 @@
 #include <math.h>
 #include <stdio.h>
 #include <time.h>
+#include "types.h"
 #include "mt_mpi.h"
 
 
-static unsigned long mt[NUM_RNG][N]; // State vector
-static int mti[NUM_RNG];       // mti[x]==N+1 means mt[x][N] is not initialized
-
-
 /* -------------------------------------------------------------------------- */
 /* Generate a seed value                                                      */
 /* -------------------------------------------------------------------------- */
@@ -72,65 +70,48 @@ unsigned long time_seed() {
 
 /* -------------------------------------------------------------------------- */
 /* Initialize state vector                                                    */
-/* my_rank        : The processor to initialize a for                         */
+/* rng            : The stream to initialize                                  */
+/* my_rank        : The processor the stream is for; added to the seed, so    */
+/*                  that each processor draws a different sequence            */
 /* seed            : A seed value to use; generate a new seed if this is 0.   */
 /* -------------------------------------------------------------------------- */
-void mt_init(int my_rank, unsigned long seed) {
-    int i;
-
+void mt_init(mt_state *rng, int my_rank, unsigned long seed) {
     if (seed == 0) seed = time_seed();
     seed += my_rank;
-    for (i = 0; i < NUM_RNG; i++) mti[i] = N+1;
-    mt[my_rank][0]= seed & 0xffffffffU;
-    for (mti[my_rank] = 1; mti[my_rank] < N; mti[my_rank]++)
-        mt[my_rank][mti[my_rank]] = (69069 * mt[my_rank][mti[my_rank]-1]) &
-        0xffffffffU;
+    rng->mt[0]= seed & 0xffffffffU;
+    for (rng->mti = 1; rng->mti < N; rng->mti++)
+        rng->mt[rng->mti] = (69069 * rng->mt[rng->mti-1]) & 0xffffffffU;
 }
 
 
 /* -------------------------------------------------------------------------- */
 /* Generate a random integer on the interval [0,0xffffffff]                   */
-/* my_rank        : The processor to generate a random number for             */
+/* rng            : The stream to generate a random number from               */
 /* -------------------------------------------------------------------------- */
-unsigned long mt_rand_32(int my_rank) {
-    int    i, kk;
+unsigned long mt_rand_32(mt_state *rng) {
+    int    kk;
     unsigned long y;
-
-    static int first = 1;
-    static unsigned long mag01[NUM_RNG][2];
-
-    // Init mag01
-    if (first == 1) {
-        for (i = 0; i < NUM_RNG; i++) {
-            mag01[i][0] = 0x0;
-            mag01[i][1] = MATRIX_A;
-        }
-        first = 0;
-    }
+    unsigned long *mt = rng->mt;
+    static const unsigned long mag01[2] = {0x0, MATRIX_A};
 
     // Generate N words at a time
-    if (mti[my_rank] >= N) {
-        if (mti[my_rank] == N+1) mt_init(my_rank, 0);
-
+    if (rng->mti >= N) {
         for (kk=0;kk<N-M;kk++) {
-            y = (mt[my_rank][kk]&UPPER_MASK)|(mt[my_rank][kk+1]&LOWER_MASK);
-            mt[my_rank][kk] = mt[my_rank][kk+M] ^
-                (y >> 1) ^ mag01[my_rank][y & 0x1];
+            y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
+            mt[kk] = mt[kk+M] ^ (y >> 1) ^ mag01[y & 0x1];
         }
 
         for (;kk<N-1;kk++) {
-            y = (mt[my_rank][kk]&UPPER_MASK)|(mt[my_rank][kk+1]&LOWER_MASK);
-            mt[my_rank][kk] = mt[my_rank][kk+(M-N)] ^
-                (y >> 1) ^ mag01[my_rank][y & 0x1];
+            y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
+            mt[kk] = mt[kk+(M-N)] ^ (y >> 1) ^ mag01[y & 0x1];
         }
 
-        y = (mt[my_rank][N-1]&UPPER_MASK)|(mt[my_rank][0]&LOWER_MASK);
-        mt[my_rank][N-1] = mt[my_rank][M-1] ^
-                (y >> 1) ^ mag01[my_rank][y & 0x1];
-        mti[my_rank] = 0;
+        y = (mt[N-1]&UPPER_MASK)|(mt[0]&LOWER_MASK);
+        mt[N-1] = mt[M-1] ^ (y >> 1) ^ mag01[y & 0x1];
+        rng->mti = 0;
     }
 
-    y = mt[my_rank][mti[my_rank]++];
+    y = mt[rng->mti++];
     y ^= (y >> 11);
     y ^= (y << 7)  & TEMPERING_MASK_B;
     y ^= (y << 15) & TEMPERING_MASK_C;
@@ -143,16 +124,16 @@ unsigned long mt_rand_32(int my_rank) {
 /* -------------------------------------------------------------------------- */
 /* Generate a random real number on the interval [0,n]                        */
 /* -------------------------------------------------------------------------- */
-long double mt_rand_real(double n, int my_rank) {
-    return mt_rand_32(my_rank)*(n/MT_MAX);
+long double mt_rand_real(double n, mt_state *rng) {
+    return mt_rand_32(rng)*(n/MT_MAX);
 }
 
 
 /* -------------------------------------------------------------------------- */
 /* Generate a random integer on the interval [0,n]                            */
 /* -------------------------------------------------------------------------- */
-int mt_rand_int(int n, int my_rank) {
-    double full_value = mt_rand_32(my_rank)*(n/MT_MAX);
+int mt_rand_int(int n, mt_state *rng) {
+    double full_value = mt_rand_32(rng)*(n/MT_MAX);
     return rint(full_value);
 }
 
@@ -160,17 +141,51 @@ int mt_rand_int(int n, int my_rank) {
 /* -------------------------------------------------------------------------- */
 /* Generate a random bit                                                      */
 /* -------------------------------------------------------------------------- */
-char mt_rand_bit(int my_rank) {
-    double full_value = mt_rand_32(my_rank)*(1.0/MT_MAX);
+char mt_rand_bit(mt_state *rng) {
+    double full_value = mt_rand_32(rng)*(1.0/MT_MAX);
     int rounded = rint(full_value);
     return rounded + '0';
 }
 
 
+/* -------------------------------------------------------------------------- */
+/* Generate a normally distributed random number with mean 0 and standard     */
+/* deviation 1, by the Box-Muller transform                                   */
+/* -------------------------------------------------------------------------- */
+double mt_rand_gauss(mt_state *rng) {
+    double u1 = (mt_rand_32(rng) + 1.0) / (MT_MAX + 2.0);
+    double u2 = mt_rand_32(rng) * (1.0/MT_MAX);
+    return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+
 /* -------------------------------------------------------------------------- */
 /* Return true with the specified probability                                 */
 /* -------------------------------------------------------------------------- */
-int mt_probability(float prob, int my_rank) {
-    return (mt_rand_real(1, my_rank) <= prob);
+int mt_probability(float prob, mt_state *rng) {
+    return (mt_rand_real(1, rng) <= prob);
 }
 
+
+
+/* -------------------------------------------------------------------------- */
+/* Copy out the state vector of a stream, e.g. for checkpointing              */
+/* rng            : The stream to copy                                        */
+/* state          : Receives the N words of the state vector                  */
+/* return         : The position of the stream within the state vector        */
+/* -------------------------------------------------------------------------- */
+int mt_get_state(mt_state *rng, unsigned long *state) {
+    int i;
+    for (i = 0; i < N; i++) state[i] = rng->mt[i];
+    return rng->mti;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Restore the state vector of a stream saved with mt_get_state               */
+/* -------------------------------------------------------------------------- */
+void mt_set_state(mt_state *rng, unsigned long *state, int pos) {
+    int i;
+    for (i = 0; i < N; i++) rng->mt[i] = state[i];
+    rng->mti = pos;
+}
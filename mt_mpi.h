@@ -1,18 +1,6 @@
 #ifndef MT_LF_H_
-#define MT_LF_H
+#define MT_LF_H_
 
-unsigned long    time_seed(void);
-void             mt_init(int, unsigned long);
-unsigned long    mt_rand_32(int);
-long double      mt_rand_real(double, int);
-int              mt_rand_int(int, int);
-char             mt_rand_bit(int);
-int              mt_probability(float, int);
-
-#endif
-
-
-#define NUM_RNG             128
 #define N                   624
 #define M                   397
 #define MT_MAX              4294967295.0
@@ -21,3 +9,26 @@ int              mt_probability(float, int);
 #define MATRIX_A            0x9908b0dfU        // Constant vector a
 #define UPPER_MASK          0x80000000U        // Most significant w-r bits
 #define LOWER_MASK          0x7fffffffU        // Least significant r bits
+
+/* -------------------------------------------------------------------------- */
+/* The state of one random number stream                                      */
+/* mt           : The state vector                                            */
+/* mti          : The position of the stream within the state vector          */
+/* -------------------------------------------------------------------------- */
+struct mt_state {
+    unsigned long   mt[N];
+    int             mti;
+};
+
+unsigned long    time_seed(void);
+void             mt_init(mt_state*, int, unsigned long);
+unsigned long    mt_rand_32(mt_state*);
+long double      mt_rand_real(double, mt_state*);
+int              mt_rand_int(int, mt_state*);
+char             mt_rand_bit(mt_state*);
+double           mt_rand_gauss(mt_state*);
+int              mt_probability(float, mt_state*);
+int              mt_get_state(mt_state*, unsigned long*);
+void             mt_set_state(mt_state*, unsigned long*, int);
+
+#endif
@@ -0,0 +1,105 @@
+/* ========================================================================== */
+/* Multi-resolution evolution of shortest paths. A run with n_points_start    */
+/* set starts with that many waypoints per path, so that early generations,   */
+/* whose paths are far from good, are cheap to evaluate. Every res_gens       */
+/* generations, the best fitness of all demes is compared with that of the    */
+/* last check; once it improves by less than RES_IMPROVE, every path is       */
+/* subdivided by inserting a waypoint midway along each of its segments, and  */
+/* the run continues at the higher resolution, up to the configured n_points. */
+/* ========================================================================== */
+#include <math.h>
+#include <mpi.h>
+#include "config.h"
+#include "fitness.h"
+#include "multires.h"
+#include "types.h"
+
+
+/* -------------------------------------------------------------------------- */
+/* Check whether the run has converged at its current resolution and, if so,  */
+/* subdivide all paths and evaluate them. Every process takes part in the     */
+/* check, so all demes always have the same resolution, as migration needs.   */
+/* -------------------------------------------------------------------------- */
+void refine_resolution(deme *subpop) {
+    int n = subpop->cfg.n_points;
+    int n_max = subpop->chr_max / point_size(subpop);
+    double best, prev = subpop->res_best;
+
+    if (subpop->ff_type != FF_SHPATH || n == n_max) return;
+    if ((subpop->cur_gen + 1) % subpop->cfg.res_gens != 0) return;
+
+    best = subpop->old_pop[subpop->fit_max]->fitness;
+    MPI_Allreduce(MPI_IN_PLACE, &best, 1, MPI_DOUBLE, MPI_MAX,
+        subpop->comm);
+    subpop->res_best = best;
+    if (prev <= 0 || best - prev >= RES_IMPROVE * prev) return;
+
+    subdivide(subpop, (2*n + 1 < n_max) ? 2*n + 1 : n_max);
+    fitness(subpop);
+
+    // Collisions may change with the new waypoints; start a new baseline
+    subpop->res_best = 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Resample every path of the population to n_points waypoints, spaced evenly */
+/* along its segments. Going from n to 2n+1 waypoints keeps every waypoint    */
+/* and inserts the midpoint of each segment.                                  */
+/* n_points      : The new number of waypoints                                */
+/* -------------------------------------------------------------------------- */
+void subdivide(deme *subpop, int n_points) {
+    int i, j, k, n = subpop->cfg.n_points;
+    int bound = coord_bound(subpop);
+    double u;
+    point path[n+2], fine[n_points+2];
+
+    for (i = 0; i < subpop->pop_size; i++) {
+        subpop->cfg.n_points = n;
+        decode_path(subpop, subpop->old_pop[i]->chr, path);
+
+        // Waypoint j lies a fraction u of the way along segment k
+        for (j = 1; j < n_points+1; j++) {
+            k = (int) ((long) j * (n+1) / (n_points+1));
+            u = (double) j * (n+1) / (n_points+1) - k;
+            fine[j].x = resample(path[k].x, path[k+1].x, u, bound);
+            fine[j].y = resample(path[k].y, path[k+1].y, u, bound);
+            fine[j].z = resample(path[k].z, path[k+1].z, u, bound);
+        }
+
+        subpop->cfg.n_points = n_points;
+        encode_path(subpop, fine, subpop->old_pop[i]->chr);
+    }
+    set_resolution(subpop, point_size(subpop) * n_points);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Interpolate one coordinate between two points, clamped to +/- bound, since */
+/* the start and end points may lie outside the range of a coordinate.        */
+/* -------------------------------------------------------------------------- */
+int resample(int a, int b, double u, int bound) {
+    int c = (int) lround(a + (b - a) * u);
+    return (c > bound) ? bound : (c < -bound) ? -bound : c;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Set the resolution of a population from its chromosome size, e.g. as read  */
+/* from a checkpoint, and select the fitness function for it                  */
+/* chr_size      : The new chromosome size                                    */
+/* return        : Non-zero on success; zero if chr_size is not a resolution  */
+/*                  of this run                                               */
+/* -------------------------------------------------------------------------- */
+int set_resolution(deme *subpop, int chr_size) {
+    int size = point_size(subpop);
+
+    if (chr_size == subpop->chr_size) return 1;
+    if (subpop->ff_type != FF_SHPATH || chr_size > subpop->chr_max
+        || chr_size < size || chr_size % size != 0) return 0;
+
+    subpop->chr_size = chr_size;
+    subpop->cfg.n_points = chr_size / size;
+    select_kernel(subpop);
+    return 1;
+}
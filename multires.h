@@ -0,0 +1,10 @@
+#ifndef MULTIRES_H_
+#define MULTIRES_H_
+#include "types.h"
+
+void    refine_resolution(deme*);
+void    subdivide(deme*, int);
+int     resample(int, int, double, int);
+int     set_resolution(deme*, int);
+
+#endif
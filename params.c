@@ -0,0 +1,148 @@
+/* ========================================================================== */
+/* Parameter file parser. A file is read and split into tokens in one pass,   */
+/* and every token ending in ':' is indexed as a key for the token after it,  */
+/* so each value is found by a binary search instead of rescanning the file.  */
+/* ========================================================================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "params.h"
+#include "types.h"
+
+
+/* -------------------------------------------------------------------------- */
+/* Order entries by key; entries with the same key keep their file order, so  */
+/* the first occurrence of a key is the one found                             */
+/* -------------------------------------------------------------------------- */
+static int compare_params(const void *a, const void *b) {
+    const param *p1 = (const param*) a, *p2 = (const param*) b;
+    int cmp = strcmp(p1->key, p2->key);
+    return (cmp != 0) ? cmp : p1->pos - p2->pos;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Read a parameter file and index its entries                                */
+/* filename      : The file to read                                           */
+/* return        : The index of the file's entries; NULL if it can't be read  */
+/* -------------------------------------------------------------------------- */
+param_index *read_params(char *filename) {
+    long size;
+    char *text;
+    FILE *fp = fopen(filename, "rb");
+
+    if (fp == NULL) return NULL;
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+
+    text = (char*) malloc(size + 1);
+    text[fread(text, 1, size, fp)] = '\0';
+    fclose(fp);
+    return parse_params(text);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Index the entries of parameter text in the format of a parameter file      */
+/* text          : The text to index, allocated with malloc; it is split into */
+/*                  tokens in place and owned by the index                    */
+/* -------------------------------------------------------------------------- */
+param_index *parse_params(char *text) {
+    int capacity = 64;
+    char *token, *prev = NULL;
+    param_index *idx = (param_index*) malloc(sizeof(param_index));
+
+    idx->text = text;
+    idx->entries = (param*) malloc(sizeof(param) * capacity);
+    idx->n = 0;
+
+    for (token = strtok(idx->text, " \t\r\n"); token != NULL;
+         token = strtok(NULL, " \t\r\n")) {
+        if (prev != NULL && prev[strlen(prev)-1] == ':') {
+            if (idx->n == capacity) {
+                capacity *= 2;
+                idx->entries = (param*) realloc(idx->entries,
+                    sizeof(param) * capacity);
+            }
+            idx->entries[idx->n].key = prev;
+            idx->entries[idx->n].value = token;
+            idx->entries[idx->n].pos = idx->n;
+            idx->n++;
+        }
+        prev = token;
+    }
+
+    qsort(idx->entries, idx->n, sizeof(param), compare_params);
+    return idx;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Free an index and the file contents it refers to                           */
+/* -------------------------------------------------------------------------- */
+void free_params(param_index *idx) {
+    free(idx->entries);
+    free(idx->text);
+    free(idx);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Find the value of the first entry with a key                               */
+/* key           : The key to look for, including the trailing ':'            */
+/* return        : The value of the entry; NULL if there is none              */
+/* -------------------------------------------------------------------------- */
+char *find_param(param_index *idx, char *key) {
+    int cmp, lo = 0, hi = idx->n;
+
+    // Find the first entry not ordered before the key
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        cmp = strcmp(idx->entries[mid].key, key);
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+
+    if (lo < idx->n && strcmp(idx->entries[lo].key, key) == 0)
+        return idx->entries[lo].value;
+    return NULL;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Get a value as a floating point number                                     */
+/* return        : The value of key, if any; -1 otherwise                     */
+/* -------------------------------------------------------------------------- */
+double param_value(param_index *idx, char *key) {
+    char *value = find_param(idx, key);
+    return (value != NULL) ? atof(value) : -1;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Get a value as a point in the format "(x,y,z)". If the value is            */
+/* incorrectly formatted, coordinates outside of SP_BOUND are used.           */
+/* p             : Receives the point                                         */
+/* return        : 1 if key was found; 0 otherwise                            */
+/* -------------------------------------------------------------------------- */
+int param_point(param_index *idx, char *key, point *p) {
+    char str[BUFFER_SIZE];
+    char *x_str, *y_str, *z_str, *value = find_param(idx, key);
+
+    if (value == NULL) return 0;
+    strncpy(str, value, BUFFER_SIZE-1);
+    str[BUFFER_SIZE-1] = '\0';
+
+    x_str = strtok(str,  "( ,)");
+    y_str = strtok(NULL, "( ,)");
+    z_str = strtok(NULL, "( ,)");
+
+    if (x_str != NULL) p->x = atoi(x_str);     else p->x = SP_BOUND+1;
+    if (y_str != NULL) p->y = atoi(y_str);     else p->y = SP_BOUND+1;
+    if (z_str != NULL) p->z = atoi(z_str);     else p->z = SP_BOUND+1;
+
+    return 1;
+}
+
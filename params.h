@@ -0,0 +1,36 @@
+#ifndef PARAMS_H_
+#define PARAMS_H_
+#include "types.h"
+
+
+/* -------------------------------------------------------------------------- */
+/* A "key: value" entry of a parameter file                                   */
+/* -------------------------------------------------------------------------- */
+typedef struct {
+    char        *key;
+    char        *value;
+    int         pos;
+} param;
+
+
+/* -------------------------------------------------------------------------- */
+/* An index of all entries in a parameter file, sorted by key                 */
+/* text         : The contents of the file, split into tokens in place        */
+/* entries      : The entries of the file                                     */
+/* n            : The number of entries                                       */
+/* -------------------------------------------------------------------------- */
+typedef struct {
+    char        *text;
+    param       *entries;
+    int         n;
+} param_index;
+
+param_index *read_params(char*);
+param_index *parse_params(char*);
+void        free_params(param_index*);
+char        *find_param(param_index*, char*);
+double      param_value(param_index*, char*);
+int         param_point(param_index*, char*, point*);
+
+#endif
+
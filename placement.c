@@ -0,0 +1,295 @@
+/* ========================================================================== */
+/* NUMA-aware placement of the memory of a deme. With numa_alloc set, the     */
+/* population and obstacle buffers are mapped separately, bound to the NUMA   */
+/* node of the CPU the process starts on, and first touched by it, so that    */
+/* they stay local however the rest of the process's memory is placed. With   */
+/* huge_pages set, large buffers are also backed by transparent (1) or        */
+/* explicit (2) huge pages, to cut TLB misses. Explicit huge pages must be    */
+/* reserved by the administrator; without them, transparent huge pages are    */
+/* used instead. The placement achieved is reported at startup.               */
+/* ========================================================================== */
+#include <linux/mempolicy.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "config.h"
+#include "placement.h"
+#include "types.h"
+
+#define PLACE_BUFS      8           // Buffers placed per deme
+#define HUGE_PAGE_SIZE  (2 << 20)
+
+
+/* -------------------------------------------------------------------------- */
+/* The placed buffers of a deme                                               */
+/* cpu, node    : The CPU the process started on, and its NUMA node           */
+/* n_bufs       : Number of buffers placed                                    */
+/* addr, size   : The start and length of each buffer's mapping               */
+/* owned        : Whether each buffer was mapped here, and is unmapped by     */
+/*                  place_free; buffers of a shared memory window are not     */
+/* -------------------------------------------------------------------------- */
+struct placement {
+    int         cpu;
+    int         node;
+    int         n_bufs;
+    char        *addr[PLACE_BUFS];
+    size_t      size[PLACE_BUFS];
+    int         owned[PLACE_BUFS];
+};
+
+
+/* -------------------------------------------------------------------------- */
+/* Start placing the buffers of a deme, if numa_alloc is set                  */
+/* -------------------------------------------------------------------------- */
+void placement_open(deme *subpop) {
+    unsigned cpu, node;
+    placement *pl;
+
+    subpop->place = NULL;
+    if (!subpop->cfg.numa_alloc) return;
+
+    pl = (placement*) malloc(sizeof(placement));
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) cpu = node = 0;
+    pl->cpu = cpu;
+    pl->node = node;
+    pl->n_bufs = 0;
+    subpop->place = pl;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Stop placing buffers. Every buffer from place_alloc must be freed first.   */
+/* -------------------------------------------------------------------------- */
+void placement_close(deme *subpop) {
+    free(subpop->place);
+    subpop->place = NULL;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Bind a range of pages to this process's node, ask for transparent huge     */
+/* pages if wanted, and touch every page so that it is allocated now          */
+/* -------------------------------------------------------------------------- */
+static void bind_local(deme *subpop, char *addr, size_t size) {
+    placement *pl = subpop->place;
+    unsigned long mask = 1UL << pl->node;
+
+#ifdef MADV_HUGEPAGE
+    if (subpop->cfg.huge_pages > 0) madvise(addr, size, MADV_HUGEPAGE);
+#endif
+    syscall(SYS_mbind, addr, size, MPOL_PREFERRED, &mask, 8*sizeof(mask), 0);
+    memset(addr, 0, size);
+
+    pl->addr[pl->n_bufs] = addr;
+    pl->size[pl->n_bufs] = size;
+    pl->owned[pl->n_bufs] = 0;
+    pl->n_bufs++;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Map anonymous memory, aligned to the huge page size if it spans at least   */
+/* one huge page, so that it can be backed by transparent huge pages          */
+/* -------------------------------------------------------------------------- */
+static char *map_aligned(size_t size) {
+    char *p, *start;
+    size_t len = size;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+    if (size >= HUGE_PAGE_SIZE) len += HUGE_PAGE_SIZE;
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (p == MAP_FAILED || len == size) return p;
+
+    // Trim the mapping to an aligned start
+    start = (char*) (((size_t) p + HUGE_PAGE_SIZE - 1) & ~(size_t)
+        (HUGE_PAGE_SIZE - 1));
+    if (start > p) munmap(p, start - p);
+    if (p + len > start + size) munmap(start + size, p + len - start - size);
+    return start;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Allocate a buffer of a deme: placed on this process's node if numa_alloc   */
+/* is set, and from malloc otherwise                                          */
+/* size          : The size of the buffer in bytes                            */
+/* return        : The buffer; must be released with place_free, or with      */
+/*                  free if place_free returns 0                              */
+/* -------------------------------------------------------------------------- */
+void *place_alloc(deme *subpop, size_t size) {
+    placement *pl = subpop->place;
+    char *p = MAP_FAILED;
+    size_t huge_size = (size + HUGE_PAGE_SIZE - 1) & ~(size_t)
+        (HUGE_PAGE_SIZE - 1);
+
+    if (pl == NULL || pl->n_bufs == PLACE_BUFS || size == 0)
+        return malloc(size);
+
+#ifdef MAP_HUGETLB
+    if (subpop->cfg.huge_pages == 2) {
+        p = mmap(NULL, huge_size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) size = huge_size;
+    }
+#endif
+    if (p == MAP_FAILED) p = map_aligned(size);
+    if (p == MAP_FAILED) return malloc(size);
+
+    bind_local(subpop, p, size);
+    pl->owned[pl->n_bufs-1] = 1;
+    return p;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Place this process's segment of a shared memory window. Only the whole     */
+/* pages within it are bound, since the pages at either end may be shared     */
+/* with the segments of other processes.                                      */
+/* -------------------------------------------------------------------------- */
+void place_shared(deme *subpop, void *addr, size_t size) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    char *start = (char*) (((size_t) addr + page - 1) & ~(page - 1));
+    char *end = (char*) (((size_t) addr + size) & ~(page - 1));
+
+    if (subpop->place == NULL || subpop->place->n_bufs == PLACE_BUFS
+        || end <= start) return;
+    bind_local(subpop, start, end - start);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Release a buffer from place_alloc                                          */
+/* return        : Non-zero if the buffer was placed, and has been unmapped;  */
+/*                  zero if it came from malloc, so that the caller frees it  */
+/* -------------------------------------------------------------------------- */
+int place_free(deme *subpop, void *addr) {
+    int i;
+    placement *pl = subpop->place;
+
+    if (pl == NULL) return 0;
+    for (i = 0; i < pl->n_bufs; i++) {
+        if (pl->addr[i] == addr && pl->owned[i]) {
+            munmap(pl->addr[i], pl->size[i]);
+            pl->addr[i] = NULL;
+            pl->owned[i] = 0;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Move the obstacles of a shortest path run into one placed buffer, holding  */
+/* the obstacle pointers, the obstacles and their centers. The obstacles are  */
+/* read before the settings are shared, so they cannot be placed at first.    */
+/* -------------------------------------------------------------------------- */
+void place_objects(deme *subpop) {
+    int i, n = subpop->n_objs;
+    object **objs, *o;
+    point *c;
+
+    if (subpop->place == NULL || subpop->ff_type != FF_SHPATH || n <= 0)
+        return;
+
+    objs = (object**) place_alloc(subpop, n * (sizeof(object*)
+        + sizeof(object) + sizeof(point)));
+    o = (object*) (objs + n);
+    c = (point*) (o + n);
+    for (i = 0; i < n; i++) {
+        o[i] = *subpop->objs[i];
+        c[i] = *subpop->objs[i]->center;
+        o[i].center = &c[i];
+        objs[i] = &o[i];
+    }
+
+    free(subpop->objs[0]->center);
+    free(subpop->objs[0]);
+    free(subpop->objs);
+    subpop->objs = objs;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Find how much of a range of memory is backed by huge pages, from the       */
+/* process's memory map. Transparent huge pages are counted over the whole    */
+/* mapping containing the range, so the result is capped at its size.         */
+/* -------------------------------------------------------------------------- */
+size_t huge_bytes(void *addr, size_t size) {
+    char line[256];
+    unsigned long start, end, kb;
+    size_t huge = 0;
+    int found = 0;
+    FILE *fp = fopen("/proc/self/smaps", "r");
+
+    if (fp == NULL) return 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        // Each mapping starts with its address range, then lists its fields
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            if (found) break;
+            found = (start <= (unsigned long) addr
+                     && (unsigned long) addr < end);
+        }
+        else if (found && sscanf(line, "AnonHugePages: %lu kB", &kb) == 1)
+            huge += kb * 1024;
+        else if (found && sscanf(line, "KernelPageSize: %lu kB", &kb) == 1
+                 && kb * 1024 >= HUGE_PAGE_SIZE)
+            huge = size;
+    }
+    fclose(fp);
+    return (huge > size) ? size : huge;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Print where the placed buffers of every process ended up: the node of its  */
+/* CPU, the share of its pages on that node, and the share backed by huge     */
+/* pages. Must be called by all processes.                                    */
+/* -------------------------------------------------------------------------- */
+void placement_report(deme *subpop) {
+    int i, j, n_procs, n_pages;
+    size_t page = sysconf(_SC_PAGESIZE);
+    placement *pl = subpop->place;
+    double local[5] = {0}, *all = NULL;
+    void **pages;
+    int *status;
+
+    if (pl == NULL) return;
+    MPI_Comm_size(subpop->comm, &n_procs);
+    local[0] = pl->cpu;
+    local[1] = pl->node;
+    for (i = 0; i < pl->n_bufs; i++) {
+        if (pl->addr[i] == NULL) continue;
+        n_pages = (pl->size[i] + page - 1) / page;
+        pages = (void**) malloc(sizeof(void*) * n_pages);
+        status = (int*) malloc(sizeof(int) * n_pages);
+        for (j = 0; j < n_pages; j++) pages[j] = pl->addr[i] + j*page;
+
+        // With no target nodes, move_pages only finds the node of each page
+        if (syscall(SYS_move_pages, 0, n_pages, pages, NULL, status, 0) == 0)
+            for (j = 0; j < n_pages; j++)
+                if (status[j] == pl->node) local[3] += page;
+        local[2] += (double) n_pages * page;
+        local[4] += huge_bytes(pl->addr[i], pl->size[i]);
+        free(pages);
+        free(status);
+    }
+
+    if (subpop->rank == 0) all = (double*) malloc(sizeof(double)*5*n_procs);
+    MPI_Gather(local, 5, MPI_DOUBLE, all, 5, MPI_DOUBLE, 0, subpop->comm);
+    if (subpop->rank == 0) {
+        for (i = 0; i < n_procs; i++) {
+            printf("Placement [%03i]: CPU %.0f, node %.0f; %.2f MB placed, "
+                "%.1f%% on node %.0f, %.1f%% in huge pages\n", i,
+                all[5*i], all[5*i+1], all[5*i+2] / (1 << 20),
+                all[5*i+2] > 0 ? 100 * all[5*i+3] / all[5*i+2] : 0,
+                all[5*i+1],
+                all[5*i+2] > 0 ? 100 * all[5*i+4] / all[5*i+2] : 0);
+        }
+        free(all);
+    }
+}
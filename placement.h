@@ -0,0 +1,15 @@
+#ifndef PLACEMENT_H_
+#define PLACEMENT_H_
+#include <stddef.h>
+#include "types.h"
+
+void    placement_open(deme*);
+void    placement_close(deme*);
+void    *place_alloc(deme*, size_t);
+void    place_shared(deme*, void*, size_t);
+int     place_free(deme*, void*);
+void    place_objects(deme*);
+void    placement_report(deme*);
+size_t  huge_bytes(void*, size_t);
+
+#endif
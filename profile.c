@@ -0,0 +1,267 @@
+/* ========================================================================== */
+/* Per-phase profiling. When enabled with -t, each process times the phases   */
+/* of every generation and counts fitness evaluations and migrated bytes.     */
+/* With -T, it also reads hardware performance counters around each phase     */
+/* via perf_event_open, where the kernel and CPU provide them. At the end of  */
+/* the run, the timers and counters are reduced across processes and the      */
+/* minimum, mean and maximum of each phase are written as JSON.               */
+/* ========================================================================== */
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <mpi.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "profile.h"
+#include "types.h"
+
+
+static const char *phase_names[N_PHASES] = {
+    "migration", "reproduction", "crossover", "mutation", "fitness",
+    "local_search", "sync_complete", "report_all", "checkpoint"
+};
+
+static const char *counter_names[N_COUNTERS] = {
+    "cycles", "instructions", "cache_misses", "branch_misses"
+};
+
+static const int counter_events[N_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+};
+
+
+/* -------------------------------------------------------------------------- */
+/* Open the hardware counters of this process as one group, so they are all   */
+/* read with a single system call. Counters the kernel or CPU don't support   */
+/* are left out; if none are supported, hw_leader is left at -1.              */
+/* -------------------------------------------------------------------------- */
+static void hw_open(deme *subpop, profile *prof) {
+    int i, my_rank;
+    struct perf_event_attr attr;
+    my_rank = subpop->rank;
+
+    for (i = 0; i < N_COUNTERS; i++) {
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = counter_events[i];
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.disabled = (prof->hw_leader == -1);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        errno = 0;
+        prof->hw_fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1,
+            prof->hw_leader, 0);
+        if (prof->hw_fd[i] >= 0 && prof->hw_leader == -1)
+            prof->hw_leader = prof->hw_fd[i];
+    }
+
+    if (prof->hw_leader == -1) {
+        if (my_rank == 0)
+            fprintf(stderr, "Warning: Hardware counters unavailable (%s); "
+                "reporting timers only\n", strerror(errno));
+        return;
+    }
+    ioctl(prof->hw_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(prof->hw_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Read the current values of the open hardware counters                      */
+/* values        : Receives the value of each counter; unavailable counters   */
+/*                  are left unchanged                                        */
+/* -------------------------------------------------------------------------- */
+static void hw_read(profile *prof, long long *values) {
+    int i, j = 0;
+    uint64_t buf[1 + N_COUNTERS];
+
+    if (read(prof->hw_leader, buf, sizeof(buf)) < (ssize_t) sizeof(uint64_t))
+        return;
+    for (i = 0; i < N_COUNTERS; i++) {
+        if (prof->hw_fd[i] >= 0 && j < buf[0]) values[i] = buf[1 + j++];
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Enable profiling of a population                                           */
+/* filename      : File to write the profile to; "-" for stdout               */
+/* hw            : Non-zero to also read hardware counters                    */
+/* -------------------------------------------------------------------------- */
+void profile_open(deme *subpop, char *filename, int hw) {
+    int i;
+    profile *prof = (profile*) malloc(sizeof(profile));
+
+    memset(prof, 0, sizeof(profile));
+    prof->file = filename;
+    prof->hw = hw;
+    prof->hw_leader = -1;
+    for (i = 0; i < N_COUNTERS; i++) prof->hw_fd[i] = -1;
+    if (hw) hw_open(subpop, prof);
+    subpop->prof = prof;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Start timing the first phase of the first generation                       */
+/* -------------------------------------------------------------------------- */
+void profile_start(deme *subpop) {
+    if (subpop->prof == NULL) return;
+    if (subpop->prof->hw_leader >= 0)
+        hw_read(subpop->prof, subpop->prof->hw_mark);
+    subpop->prof->evals_start = subpop->n_evals;
+    subpop->prof->mark = MPI_Wtime();
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* End the current phase and start the next one. The time since the end of    */
+/* the previous phase is added to phase.                                      */
+/* -------------------------------------------------------------------------- */
+void profile_lap(deme *subpop, int phase) {
+    int i;
+    double now;
+    long long counts[N_COUNTERS];
+    profile *prof = subpop->prof;
+    if (prof == NULL) return;
+
+    now = MPI_Wtime();
+    prof->time[phase] += now - prof->mark;
+    prof->mark = now;
+    if (phase == N_PHASES-1) prof->n_gens++;
+
+    if (prof->hw_leader >= 0) {
+        memcpy(counts, prof->hw_mark, sizeof(counts));
+        hw_read(prof, counts);
+        for (i = 0; i < N_COUNTERS; i++) {
+            prof->hw_count[phase][i] += counts[i] - prof->hw_mark[i];
+            prof->hw_mark[i] = counts[i];
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Print the min/mean/max of a time across processes, and its imbalance: the  */
+/* ratio of the max to the mean, where 1 means perfectly balanced             */
+/* -------------------------------------------------------------------------- */
+static void print_stat(FILE *fp, const char *indent, const char *name,
+        double min, double sum, double max, int n_procs, int last) {
+    double mean = sum / n_procs;
+
+    fprintf(fp, "%s\"%s\": {\"min\": %.6f, \"mean\": %.6f, \"max\": %.6f, "
+        "\"imbalance\": %.3f}%s\n", indent, name, min, mean, max,
+        mean > 0 ? max / mean : 1.0, last ? "" : ",");
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Print the min/mean/max across processes of each hardware counter in one    */
+/* phase, and the instructions per cycle. Counters unavailable on any process */
+/* are printed as null.                                                       */
+/* -------------------------------------------------------------------------- */
+static void print_counters(FILE *fp, const char *name, double *min,
+        double *sum, double *max, int *avail, int n_procs, int last) {
+    int i;
+
+    fprintf(fp, "    \"%s\": {", name);
+    for (i = 0; i < N_COUNTERS; i++) {
+        if (avail[i])
+            fprintf(fp, "\"%s\": {\"min\": %.0f, \"mean\": %.0f, "
+                "\"max\": %.0f}, ", counter_names[i], min[i],
+                sum[i] / n_procs, max[i]);
+        else fprintf(fp, "\"%s\": null, ", counter_names[i]);
+    }
+    if (avail[HW_CYCLES] && avail[HW_INSTRUCTIONS] && sum[HW_CYCLES] > 0)
+        fprintf(fp, "\"ipc\": %.3f}", sum[HW_INSTRUCTIONS] / sum[HW_CYCLES]);
+    else fprintf(fp, "\"ipc\": null}");
+    fprintf(fp, "%s\n", last ? "" : ",");
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Reduce the profile of every process onto process 0, which writes it as     */
+/* JSON, and disable profiling. Must be called by all processes.              */
+/* elapsed       : This process's elapsed time for the whole run              */
+/* -------------------------------------------------------------------------- */
+void profile_report(deme *subpop, double elapsed) {
+    int i, j, my_rank, n_procs, avail[N_COUNTERS], all_avail[N_COUNTERS];
+    double t[N_PHASES+1], t_min[N_PHASES+1], t_sum[N_PHASES+1];
+    double t_max[N_PHASES+1], counts[2], totals[2];
+    double hw[N_PHASES][N_COUNTERS], hw_min[N_PHASES][N_COUNTERS];
+    double hw_sum[N_PHASES][N_COUNTERS], hw_max[N_PHASES][N_COUNTERS];
+    FILE *fp;
+    profile *prof = subpop->prof;
+    if (prof == NULL) return;
+
+    my_rank = subpop->rank;
+    MPI_Comm_size(subpop->comm, &n_procs);
+    memcpy(t, prof->time, sizeof(prof->time));
+    t[N_PHASES] = elapsed;
+    counts[0] = subpop->n_evals - prof->evals_start;
+    counts[1] = prof->bytes_mig;
+    MPI_Reduce(t, t_min, N_PHASES+1, MPI_DOUBLE, MPI_MIN, 0, subpop->comm);
+    MPI_Reduce(t, t_sum, N_PHASES+1, MPI_DOUBLE, MPI_SUM, 0, subpop->comm);
+    MPI_Reduce(t, t_max, N_PHASES+1, MPI_DOUBLE, MPI_MAX, 0, subpop->comm);
+    MPI_Reduce(counts, totals, 2, MPI_DOUBLE, MPI_SUM, 0, subpop->comm);
+
+    if (prof->hw) {
+        for (j = 0; j < N_COUNTERS; j++) {
+            avail[j] = (prof->hw_fd[j] >= 0);
+            for (i = 0; i < N_PHASES; i++) hw[i][j] = prof->hw_count[i][j];
+            if (prof->hw_fd[j] >= 0) close(prof->hw_fd[j]);
+        }
+        MPI_Reduce(avail, all_avail, N_COUNTERS, MPI_INT, MPI_MIN, 0,
+            subpop->comm);
+        MPI_Reduce(hw, hw_min, N_PHASES*N_COUNTERS, MPI_DOUBLE, MPI_MIN, 0,
+            subpop->comm);
+        MPI_Reduce(hw, hw_sum, N_PHASES*N_COUNTERS, MPI_DOUBLE, MPI_SUM, 0,
+            subpop->comm);
+        MPI_Reduce(hw, hw_max, N_PHASES*N_COUNTERS, MPI_DOUBLE, MPI_MAX, 0,
+            subpop->comm);
+    }
+
+    if (my_rank == 0) {
+        errno = 0;
+        fp = strcmp(prof->file, "-") == 0 ? stdout : fopen(prof->file, "w");
+        if (fp == NULL) {
+            fprintf(stderr, "Error %i: %s\n", errno, strerror(errno));
+            MPI_Abort(MPI_COMM_WORLD, -1);
+        }
+
+        fprintf(fp, "{\n");
+        fprintf(fp, "  \"n_procs\": %i,\n", n_procs);
+        fprintf(fp, "  \"pop_size\": %i,\n", subpop->pop_size);
+        fprintf(fp, "  \"generations\": %i,\n", prof->n_gens);
+        fprintf(fp, "  \"evaluations\": %.0f,\n", totals[0]);
+        fprintf(fp, "  \"evals_per_sec\": %.1f,\n",
+            t_max[N_PHASES] > 0 ? totals[0] / t_max[N_PHASES] : 0.0);
+        fprintf(fp, "  \"bytes_migrated\": %.0f,\n", totals[1]);
+        print_stat(fp, "  ", "elapsed", t_min[N_PHASES], t_sum[N_PHASES],
+            t_max[N_PHASES], n_procs, 0);
+        fprintf(fp, "  \"phases\": {\n");
+        for (i = 0; i < N_PHASES; i++)
+            print_stat(fp, "    ", phase_names[i], t_min[i], t_sum[i], t_max[i],
+                n_procs, i == N_PHASES-1);
+        fprintf(fp, "  }%s\n", prof->hw ? "," : "");
+        if (prof->hw) {
+            fprintf(fp, "  \"hw_counters\": {\n");
+            for (i = 0; i < N_PHASES; i++)
+                print_counters(fp, phase_names[i], hw_min[i], hw_sum[i],
+                    hw_max[i], all_avail, n_procs, i == N_PHASES-1);
+            fprintf(fp, "  }\n");
+        }
+        fprintf(fp, "}\n");
+        if (fp != stdout) fclose(fp);
+    }
+
+    free(prof);
+    subpop->prof = NULL;
+}
@@ -0,0 +1,60 @@
+#ifndef PROFILE_H_
+#define PROFILE_H_
+#include "types.h"
+
+#define PH_MIGRATION        0
+#define PH_REPRODUCTION     1
+#define PH_CROSSOVER        2
+#define PH_MUTATION         3
+#define PH_FITNESS          4
+#define PH_LOCAL_SEARCH     5
+#define PH_SYNC             6
+#define PH_REPORT           7
+#define PH_CHECKPOINT       8
+#define N_PHASES            9
+
+#define HW_CYCLES           0
+#define HW_INSTRUCTIONS     1
+#define HW_CACHE_MISSES     2
+#define HW_BRANCH_MISSES    3
+#define N_COUNTERS          4
+
+
+/* -------------------------------------------------------------------------- */
+/* Per-phase timers and counters of one process                               */
+/* file         : File the aggregated profile is written to; "-" for stdout   */
+/* mark         : Time at which the current phase started                     */
+/* time         : Total time spent in each phase                              */
+/* n_gens       : Number of generations profiled                              */
+/* evals_start  : Number of fitness evaluations before profiling started      */
+/* bytes_mig    : Number of bytes of migrants received                        */
+/*                                                                            */
+/* Hardware counters, if enabled and available:                               */
+/* hw           : Non-zero if hardware counters were requested                */
+/* hw_fd        : perf event file descriptor of each counter; -1 if the       */
+/*                  counter is disabled or unavailable                        */
+/* hw_leader    : Descriptor of the event group read at each lap; -1 if no    */
+/*                  counters are open                                         */
+/* hw_mark      : Counter values at the start of the current phase            */
+/* hw_count     : Total count of each counter in each phase                   */
+/* -------------------------------------------------------------------------- */
+struct profile {
+    char        *file;
+    double      mark;
+    double      time[N_PHASES];
+    int         n_gens;
+    double      evals_start;
+    double      bytes_mig;
+    int         hw;
+    int         hw_fd[N_COUNTERS];
+    int         hw_leader;
+    long long   hw_mark[N_COUNTERS];
+    long long   hw_count[N_PHASES][N_COUNTERS];
+};
+
+void    profile_open(deme*, char*, int);
+void    profile_start(deme*);
+void    profile_lap(deme*, int);
+void    profile_report(deme*, double);
+
+#endif
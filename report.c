@@ -1,6 +1,8 @@
 /* ========================================================================== */
 /* Functions for reporting population statistics and other info               */
 /* ========================================================================== */
+#include <limits.h>
+#include <math.h>
 #include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,6 +12,7 @@
 #include "fitness.h"
 #include "types.h"
 #include "report.h"
+#include "runlog.h"
 
 
 /* -------------------------------------------------------------------------- */
@@ -26,8 +29,8 @@ void report_member(deme *subpop, char *chr) {
             binToDecimal(chr, 24, 31));
     }
     else {
-        point **path = make_path(chr, subpop->s, subpop->t);
-        for (i = 0; i < N_POINTS+2; i++)
+        point **path = make_path(subpop, chr);
+        for (i = 0; i < subpop->cfg.n_points+2; i++)
             printf("%i: (%i,%i,%i)\n", i, path[i]->x, path[i]->y, path[i]->z);
         free_path(path);
     }
@@ -36,31 +39,41 @@ void report_member(deme *subpop, char *chr) {
 
 
 /* -------------------------------------------------------------------------- */
-/* Print overall population data                                              */
+/* Print overall population data. If a run log is open, stats are logged      */
+/* every generation instead, along with the population at the usual rate.     */
 /* -------------------------------------------------------------------------- */
 void report_all(deme* subpop) {
     int i, my_rank;
     char chr[subpop->chr_size+1];
-    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+    settings *cfg = &subpop->cfg;
+    int due = cfg->prnt_rate > 0 && (subpop->cur_gen <= 1
+        || subpop->cur_gen % cfg->prnt_rate == cfg->prnt_rate - 1
+        || subpop->complete);
+    my_rank = subpop->rank;
 
-    if (PRNT_RATE > 0 && (subpop->cur_gen <= 1
-        || subpop->cur_gen % PRNT_RATE == PRNT_RATE - 1 || subpop->complete)) {
-        if (PRNT_DATA && (PRNT_CHRS || PRNT_INFO || PRNT_FITS)) {
+    if (subpop->log != NULL) {
+        if (cfg->prnt_stat) runlog_stats(subpop);
+        if (due && cfg->prnt_data) runlog_population(subpop);
+    }
+    else if (due) {
+        if (cfg->prnt_data
+            && (cfg->prnt_chrs || cfg->prnt_info || cfg->prnt_fits)) {
             for (i = 0; i < subpop->pop_size; i++) {
                 printf("%03i: ", i+1);
-                if (PRNT_CHRS) {
-                    strncpy(chr, subpop->new_pop[i]->chr, subpop->chr_size);
+                // Integer genomes are only shown decoded, by prnt_info
+                if (cfg->prnt_chrs && cfg->genome == GENOME_BINARY) {
+                    memcpy(chr, subpop->new_pop[i]->chr, subpop->chr_size);
                     chr[subpop->chr_size] = '\0';
                     printf("%s ", chr);
                 }
-                if (PRNT_INFO)
+                if (cfg->prnt_info)
                     report_member(subpop, subpop->new_pop[i]->chr);
-                if (PRNT_FITS)
+                if (cfg->prnt_fits)
                     printf("%.0f", subpop->new_pop[i]->fitness);
                 printf("\n");
             }
         }
-        if (PRNT_STAT) {
+        if (cfg->prnt_stat) {
             printf("[Deme %03i][Gen %06i] ", my_rank, subpop->cur_gen);
             printf("Total:%08.0f ", subpop->fit_tot);
             printf("Avg:%06.0f ", subpop->fit_avg);
@@ -76,8 +89,9 @@ void report_all(deme* subpop) {
 /* -------------------------------------------------------------------------- */
 void report_fittest(deme *subpop) {
     int          source, my_rank, n_procs, global_max = 0;
-    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &n_procs);
+    settings    *cfg = &subpop->cfg;
+    my_rank = subpop->rank;
+    MPI_Comm_size(subpop->comm, &n_procs);
     MPI_Status    status;
     char        local_fit[subpop->chr_size];
     char        fittest[n_procs][subpop->chr_size+1];
@@ -86,25 +100,25 @@ void report_fittest(deme *subpop) {
     // Every process except 0 sends its most fit member to process 0
     if (my_rank != 0) {
         MPI_Send(subpop->new_pop[subpop->fit_max]->chr, subpop->chr_size,
-            MPI_CHAR, 0, 50, MPI_COMM_WORLD);
+            MPI_CHAR, 0, 50, subpop->comm);
         MPI_Send(&subpop->new_pop[subpop->fit_max]->fitness, 1, MPI_DOUBLE, 0,
-         50, MPI_COMM_WORLD);
+         50, subpop->comm);
     }
 
     // Process 0 collects the most fit member of it and every other process
     else {
-        strncpy(fittest[0], subpop->new_pop[subpop->fit_max]->chr,
+        memcpy(fittest[0], subpop->new_pop[subpop->fit_max]->chr,
             subpop->chr_size);
         fittest[0][subpop->chr_size] = '\0';
         maxima[0] = subpop->new_pop[subpop->fit_max]->fitness;
 
         for (source = 1; source < n_procs; source++) {
             MPI_Recv(local_fit, subpop->chr_size, MPI_CHAR, source,
-                50, MPI_COMM_WORLD, &status);
+                50, subpop->comm, &status);
             MPI_Recv(&maxima[source], 1, MPI_DOUBLE, source, 50,
-                MPI_COMM_WORLD,
+                subpop->comm,
                 &status);
-            strncpy(fittest[source], local_fit, subpop->chr_size);
+            memcpy(fittest[source], local_fit, subpop->chr_size);
             fittest[source][subpop->chr_size] = '\0';
         }
 
@@ -114,16 +128,77 @@ void report_fittest(deme *subpop) {
             if (maxima[source] > maxima[global_max]) global_max = source;
 
         printf("Best solution found:\n");
-        if (PRNT_CHRS) printf("%s\n", fittest[global_max]);
-        if (PRNT_INFO) report_member(subpop, fittest[global_max]);
-        if (PRNT_FITS) printf("\nFitness: %.0f",maxima[global_max]);
+        if (cfg->prnt_chrs && cfg->genome == GENOME_BINARY)
+            printf("%s\n", fittest[global_max]);
+        if (cfg->prnt_info) report_member(subpop, fittest[global_max]);
+        if (cfg->prnt_fits) printf("\nFitness: %.0f",maxima[global_max]);
         printf("\n");
     }
 }
 
 
 /* -------------------------------------------------------------------------- */
-/* Print a usage statement and exit the program                               */
+/* Record the first generation and time at which the best member of this      */
+/* population reaches each fitness target. Called once per generation.        */
+/* -------------------------------------------------------------------------- */
+void check_targets(deme *subpop) {
+    int i;
+    double best = subpop->old_pop[subpop->fit_max]->fitness;
+
+    for (i = 0; i < subpop->cfg.n_targets; i++) {
+        if (subpop->tgt_gen[i] < 0 && best >= subpop->cfg.targets[i]) {
+            subpop->tgt_gen[i] = subpop->cur_gen;
+            subpop->tgt_time[i] = MPI_Wtime() - subpop->start_time;
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Report when the global best member first reached each fitness target,      */
+/* i.e. the earliest time and generation at which any population reached it,  */
+/* and the number of evaluations and evaluations/sec of each process.         */
+/* Must be called by all processes.                                           */
+/* elapsed       : This process's elapsed time for the main loop              */
+/* -------------------------------------------------------------------------- */
+void report_targets(deme *subpop, double elapsed) {
+    int i, my_rank, n_procs, n = subpop->cfg.n_targets;
+    int gens[MAX_TARGETS], min_gens[MAX_TARGETS];
+    double times[MAX_TARGETS], min_times[MAX_TARGETS];
+    double rate, rates[3], evals;
+    my_rank = subpop->rank;
+    MPI_Comm_size(subpop->comm, &n_procs);
+
+    // Targets not reached count as INT_MAX generations and infinite time
+    for (i = 0; i < n; i++) {
+        gens[i] = subpop->tgt_gen[i] < 0 ? INT_MAX : subpop->tgt_gen[i];
+        times[i] = subpop->tgt_gen[i] < 0 ? INFINITY : subpop->tgt_time[i];
+    }
+    rate = elapsed > 0 ? subpop->n_evals / elapsed : 0;
+    if (n > 0) {
+        MPI_Reduce(gens, min_gens, n, MPI_INT, MPI_MIN, 0, subpop->comm);
+        MPI_Reduce(times, min_times, n, MPI_DOUBLE, MPI_MIN, 0,
+            subpop->comm);
+    }
+    MPI_Reduce(&rate, &rates[0], 1, MPI_DOUBLE, MPI_MIN, 0, subpop->comm);
+    MPI_Reduce(&rate, &rates[1], 1, MPI_DOUBLE, MPI_SUM, 0, subpop->comm);
+    MPI_Reduce(&rate, &rates[2], 1, MPI_DOUBLE, MPI_MAX, 0, subpop->comm);
+    MPI_Reduce(&subpop->n_evals, &evals, 1, MPI_DOUBLE, MPI_SUM, 0,
+        subpop->comm);
+    if (my_rank != 0) return;
+
+    for (i = 0; i < n; i++) {
+        printf("Target %.0f: ", subpop->cfg.targets[i]);
+        if (min_gens[i] == INT_MAX) printf("not reached\n");
+        else printf("Gen %i, %f s\n", min_gens[i], min_times[i]);
+    }
+    printf("Evaluations: %.0f; per process: %.0f/s min, %.0f/s mean, "
+        "%.0f/s max\n", evals, rates[0], rates[1] / n_procs, rates[2]);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Print a usage statement                                                    */
 /* -------------------------------------------------------------------------- */
 void usage() {
     printf("\n\nUsage: ga [flag] [FILE]\n");
@@ -134,15 +209,32 @@ void usage() {
     printf("\t-ue: Initialize with user-specified values; exports data\n");
     printf("\t    to a file without running the program.\n");
     printf("\t-i: Initialize data from a previously generated file.\n");
+    printf("\t-b: Run each instance listed in a manifest FILE, one line\n");
+    printf("\t    per instance of the form: PARAMFILE [OPTIONS]. With\n");
+    printf("\t    -g SIZE, the processes are split into groups of SIZE\n");
+    printf("\t    (default %i), which run instances in parallel.\n",
+        BATCH_GROUP_SIZE);
     printf("\tA valid filename must be specified if importing or exporting.");
-    printf("\n\n");
-
-    exit(-1);
+    printf("\n\nOptions (following the flag above):\n");
+    printf("\t-c FILE: Write a checkpoint to FILE every %i generations\n",
+        CKPT_RATE);
+    printf("\t-r FILE: Restart from a checkpoint written with the same\n");
+    printf("\t    parameters and number of processes\n");
+    printf("\t-l PREFIX: Write reports to binary logs PREFIX.<rank>\n");
+    printf("\t    instead of stdout; decode them with gadump\n");
+    printf("\t-o FILE: Write a snapshot of the final population to FILE\n");
+    printf("\t-s FILE: Start from the population in a snapshot FILE\n");
+    printf("\t-t FILE: Write per-phase timings to FILE as JSON (- for\n");
+    printf("\t    stdout)\n");
+    printf("\t-T FILE: As -t, and also read hardware performance counters\n");
+    printf("\t    in each phase, where available\n");
+    printf("\t-p KEY=VALUE: Override a parameter, e.g. -p n_points=16;\n");
+    printf("\t    may be repeated\n\n");
 }
 
 
 /* -------------------------------------------------------------------------- */
-/* Print info on usage of program parameters and exit the program             */
+/* Print info on usage of program parameters                                  */
 /* -------------------------------------------------------------------------- */
 void usage2() {
     printf("\n\nUser-specified values:\n\n");
@@ -159,7 +251,8 @@ void usage2() {
     printf("0: Fixed number of generations\n");
     printf("1: Maximum fitness threshhold\n");
     printf("2: Average fitness threshhold\n");
-    printf("3: Local convergence\n\n");
+    printf("3: Local convergence\n");
+    printf("4: Wall-clock time limit\n\n");
     printf("End generation:\nA positive integer value for the number of ");
     printf("generations, if a termination type of fixed generations was ");
     printf("selected\n\n");
@@ -173,6 +266,9 @@ void usage2() {
     printf("Convergence variation:\nA positive value for the variation ");
     printf("allowed for a local convergence, if a termination type of local ");
     printf("convergence was selected\n\n");
+    printf("Time limit:\nA positive value for the wall-clock time in ");
+    printf("seconds the run may take, if a termination type of wall-clock ");
+    printf("time limit was selected\n\n");
     printf("RNG seed:\nA value used to initialize the random rumber ");
     printf("generator. 0 may be used to generate a new seed value. Mutliple ");
     printf("runs of the program with the same seed value will yield the ");
@@ -185,7 +281,5 @@ void usage2() {
     printf("path must be constructed. Each object is aproximated by a ");
     printf("sphere, with a center entered in the format (x,y,z) and a ");
     printf("positive integer value for the radius.\n");
-
-    exit(-1);
 }
 
@@ -5,6 +5,8 @@
 void    report_member(deme*, char*);
 void    report_all(deme*);
 void    report_fittest(deme*);
+void    check_targets(deme*);
+void    report_targets(deme*, double);
 void    usage(void);
 void    usage2(void);
 
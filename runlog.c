@@ -0,0 +1,198 @@
+/* ========================================================================== */
+/* Binary run log. Reports are appended as fixed-size records to a ring       */
+/* buffer in memory, which a background thread drains to one file per         */
+/* process, so the GA never waits on terminal or file system I/O unless the   */
+/* buffer fills up. Use gadump to decode a log.                               */
+/* ========================================================================== */
+#include <mpi.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "fitness.h"
+#include "runlog.h"
+#include "types.h"
+
+
+/* -------------------------------------------------------------------------- */
+/* A ring buffer of pending log data and the thread that writes it out        */
+/* buf          : The ring buffer of LOG_BUFFER_SIZE bytes                    */
+/* head         : Total number of bytes written out to the file               */
+/* tail         : Total number of bytes appended to the buffer                */
+/* closing      : Set once no more data will be appended                      */
+/* -------------------------------------------------------------------------- */
+struct runlog {
+    FILE            *fp;
+    char            *buf;
+    size_t          head;
+    size_t          tail;
+    int             closing;
+    pthread_t       writer;
+    pthread_mutex_t lock;
+    pthread_cond_t  not_empty;
+    pthread_cond_t  not_full;
+};
+
+
+/* -------------------------------------------------------------------------- */
+/* Background thread; writes buffered data to the file until the log closes   */
+/* -------------------------------------------------------------------------- */
+static void *runlog_writer(void *arg) {
+    runlog *log = (runlog*) arg;
+    size_t start, len;
+
+    pthread_mutex_lock(&log->lock);
+    for (;;) {
+        while (log->head == log->tail && !log->closing)
+            pthread_cond_wait(&log->not_empty, &log->lock);
+        if (log->head == log->tail) break;
+
+        // Write the longest contiguous run of data, without holding the lock
+        start = log->head % LOG_BUFFER_SIZE;
+        len = log->tail - log->head;
+        if (start + len > LOG_BUFFER_SIZE) len = LOG_BUFFER_SIZE - start;
+        pthread_mutex_unlock(&log->lock);
+        fwrite(log->buf + start, 1, len, log->fp);
+        pthread_mutex_lock(&log->lock);
+
+        log->head += len;
+        pthread_cond_signal(&log->not_full);
+    }
+    pthread_mutex_unlock(&log->lock);
+
+    return NULL;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Append data to the ring buffer, waiting for space only if it is full       */
+/* -------------------------------------------------------------------------- */
+static void runlog_append(runlog *log, void *data, size_t len) {
+    size_t start, part;
+
+    pthread_mutex_lock(&log->lock);
+    while (LOG_BUFFER_SIZE - (log->tail - log->head) < len)
+        pthread_cond_wait(&log->not_full, &log->lock);
+
+    start = log->tail % LOG_BUFFER_SIZE;
+    part = (start + len > LOG_BUFFER_SIZE) ? LOG_BUFFER_SIZE - start : len;
+    memcpy(log->buf + start, data, part);
+    memcpy(log->buf, (char*) data + part, len - part);
+    log->tail += len;
+
+    pthread_cond_signal(&log->not_empty);
+    pthread_mutex_unlock(&log->lock);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Open this process's log file, <prefix>.<rank>, and start its writer thread */
+/* return        : 0 on success; non-zero if the file could not be opened     */
+/* -------------------------------------------------------------------------- */
+int runlog_open(deme *subpop, char *prefix) {
+    int my_rank, n_procs;
+    char filename[strlen(prefix) + 16];
+    log_header hdr;
+    runlog *log = (runlog*) malloc(sizeof(runlog));
+    my_rank = subpop->rank;
+    MPI_Comm_size(subpop->comm, &n_procs);
+
+    sprintf(filename, "%s.%i", prefix, my_rank);
+    log->fp = fopen(filename, "wb");
+    if (log->fp == NULL) {
+        fprintf(stderr, "Error: Could not open log %s\n", filename);
+        free(log);
+        return -1;
+    }
+
+    log->buf = (char*) malloc(LOG_BUFFER_SIZE);
+    log->head = 0;
+    log->tail = 0;
+    log->closing = 0;
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_cond_init(&log->not_empty, NULL);
+    pthread_cond_init(&log->not_full, NULL);
+    pthread_create(&log->writer, NULL, runlog_writer, log);
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = LOG_MAGIC;
+    hdr.rank = my_rank;
+    hdr.n_procs = n_procs;
+    hdr.pop_size = subpop->pop_size;
+    hdr.chr_size = subpop->chr_max;
+    hdr.ff_type = subpop->ff_type;
+    hdr.n_points = subpop->cfg.n_points;
+    hdr.coord_size = subpop->cfg.coord_size;
+    if (subpop->ff_type == FF_SHPATH) {
+        pt_copy(&hdr.s, subpop->s);
+        pt_copy(&hdr.t, subpop->t);
+    }
+    runlog_append(log, &hdr, sizeof(hdr));
+
+    subpop->log = log;
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Flush all buffered records, stop the writer thread and close the log       */
+/* -------------------------------------------------------------------------- */
+void runlog_close(deme *subpop) {
+    runlog *log = subpop->log;
+    if (log == NULL) return;
+
+    pthread_mutex_lock(&log->lock);
+    log->closing = 1;
+    pthread_cond_signal(&log->not_empty);
+    pthread_mutex_unlock(&log->lock);
+    pthread_join(log->writer, NULL);
+
+    fclose(log->fp);
+    pthread_mutex_destroy(&log->lock);
+    pthread_cond_destroy(&log->not_empty);
+    pthread_cond_destroy(&log->not_full);
+    free(log->buf);
+    free(log);
+    subpop->log = NULL;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Log the population stats of the current generation                         */
+/* -------------------------------------------------------------------------- */
+void runlog_stats(deme *subpop) {
+    log_record rec;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.type = LOG_STAT;
+    rec.gen = subpop->cur_gen;
+    rec.index = subpop->fit_max;
+    rec.value[0] = subpop->fit_tot;
+    rec.value[1] = subpop->fit_avg;
+    rec.value[2] = subpop->new_pop[subpop->fit_max]->fitness;
+    runlog_append(subpop->log, &rec, sizeof(rec));
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Log every member of the current generation with its packed chromosome      */
+/* -------------------------------------------------------------------------- */
+void runlog_population(deme *subpop) {
+    int i, n_bytes = (subpop->chr_size + 7) / 8;
+    unsigned char packed[n_bytes];
+    log_record rec;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.type = LOG_MEMBER;
+    rec.gen = subpop->cur_gen;
+    rec.chr_size = subpop->chr_size;
+    for (i = 0; i < subpop->pop_size; i++) {
+        rec.index = i;
+        rec.value[0] = subpop->new_pop[i]->fitness;
+        pack_chr(subpop->new_pop[i]->chr, subpop->chr_size, packed);
+        runlog_append(subpop->log, &rec, sizeof(rec));
+        runlog_append(subpop->log, packed, n_bytes);
+    }
+}
+
@@ -0,0 +1,51 @@
+#ifndef RUNLOG_H_
+#define RUNLOG_H_
+#include "types.h"
+
+#define LOG_MAGIC           0x4741474c  // "GAGL"
+#define LOG_STAT            1
+#define LOG_MEMBER          2
+
+
+/* -------------------------------------------------------------------------- */
+/* Header at the start of each process's log file. chr_size is the largest    */
+/* chromosome size of the run, and n_points the initial number of waypoints.  */
+/* -------------------------------------------------------------------------- */
+typedef struct {
+    int         magic;
+    int         rank;
+    int         n_procs;
+    int         pop_size;
+    int         chr_size;
+    int         ff_type;
+    int         n_points;
+    int         coord_size;
+    point       s;
+    point       t;
+} log_header;
+
+
+/* -------------------------------------------------------------------------- */
+/* A fixed-size log record.                                                   */
+/* LOG_STAT     : value holds the total, average and maximum fitness, and     */
+/*                  index is the index of the most fit member                 */
+/* LOG_MEMBER   : value[0] holds the fitness of the member at index; the      */
+/*                  record is followed by the member's packed chromosome of   */
+/*                  (chr_size+7)/8 bytes, where chr_size is that of the       */
+/*                  record, or of the header if the record's is 0             */
+/* -------------------------------------------------------------------------- */
+typedef struct {
+    int         type;
+    int         gen;
+    int         index;
+    int         chr_size;
+    double      value[3];
+} log_record;
+
+int     runlog_open(deme*, char*);
+void    runlog_close(deme*);
+void    runlog_stats(deme*);
+void    runlog_population(deme*);
+
+#endif
+
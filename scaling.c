@@ -0,0 +1,221 @@
+/* ========================================================================== */
+/* Scaling benchmark driver. Runs ga on one parameter file over a list of     */
+/* process counts, repeating each run, and tabulates elapsed time, speedup,   */
+/* efficiency and throughput from the profiles written by ga -t.              */
+/*                                                                            */
+/* Strong scaling keeps the total population fixed, dividing it among the     */
+/* demes; weak scaling keeps each deme's pop_size fixed. With a target        */
+/* fitness, each run ends when a deme's best member reaches it, so the times  */
+/* are times to solution; a run that has not reached it within a time cap is  */
+/* stopped, and its process count is reported as not reached.                 */
+/* ========================================================================== */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "config.h"
+#include "params.h"
+
+#define SCALING_REPS        3       // Default number of runs per process count
+#define SCALING_MPIRUN      "mpirun"
+#define SCALING_MAX_NPS     64
+#define SCALING_TIME_CAP    600     // Default seconds per run to reach -f
+#define SCALING_TIMEOUT     "timeout"
+
+
+/* -------------------------------------------------------------------------- */
+/* Results of the runs at one process count                                   */
+/* n_procs      : Number of processes                                         */
+/* pop_size     : Population size of each deme                                */
+/* t_mean       : Mean elapsed time of the runs (max over processes)          */
+/* t_min        : Minimum elapsed time of the runs                            */
+/* t_std        : Standard deviation of the elapsed times                     */
+/* evals        : Mean evaluations per second                                 */
+/* reached      : Zero if a run did not reach the target fitness in time      */
+/* -------------------------------------------------------------------------- */
+typedef struct {
+    int         n_procs;
+    int         pop_size;
+    int         reached;
+    double      t_mean;
+    double      t_min;
+    double      t_std;
+    double      evals;
+} scaling_row;
+
+int     run_ga(char*, char*, int, int, char*, double, double*, double*);
+void    scaling_usage(void);
+
+
+int main(int argc, char *argv[]) {
+    int i, j, opt, n_nps = 0, weak = 0, reps = SCALING_REPS, total = 0;
+    int base_pop, status;
+    char *mpirun = SCALING_MPIRUN, *target = NULL, *filename;
+    double t, evals, sum, sum_sq, speedup, eff, cap = SCALING_TIME_CAP;
+    scaling_row rows[SCALING_MAX_NPS];
+    param_index *idx;
+
+    while ((opt = getopt(argc, argv, "wn:P:f:c:m:")) != -1) {
+        if      (opt == 'w') weak = 1;
+        else if (opt == 'n') reps = atoi(optarg);
+        else if (opt == 'P') total = atoi(optarg);
+        else if (opt == 'f') target = optarg;
+        else if (opt == 'c') cap = atof(optarg);
+        else if (opt == 'm') mpirun = optarg;
+        else scaling_usage();
+    }
+    if (argc - optind < 2 || reps < 1 || cap <= 0) scaling_usage();
+    filename = argv[optind];
+
+    idx = read_params(filename);
+    if (idx == NULL) {
+        fprintf(stderr, "Error: Cannot read %s\n", filename);
+        exit(-1);
+    }
+    base_pop = param_value(idx, "pop_size:");
+    free_params(idx);
+
+    for (i = optind + 1; i < argc && n_nps < SCALING_MAX_NPS; i++) {
+        rows[n_nps].n_procs = atoi(argv[i]);
+        if (rows[n_nps].n_procs < 1) scaling_usage();
+        n_nps++;
+    }
+    if (!weak && total == 0) total = base_pop * rows[0].n_procs;
+
+    if (weak) printf("Weak scaling: %s, pop_size %i", filename, base_pop);
+    else printf("Strong scaling: %s, total population %i", filename, total);
+    printf(", %i repetitions", reps);
+    if (target != NULL)
+        printf(", time to fitness %s (at most %g s)", target, cap);
+    printf("\n\n");
+
+    for (i = 0; i < n_nps; i++) {
+        rows[i].pop_size = weak ? base_pop : total / rows[i].n_procs;
+        rows[i].pop_size -= rows[i].pop_size % 2;
+        if (rows[i].pop_size < 2) {
+            fprintf(stderr, "Error: Population too small for %i processes\n",
+                rows[i].n_procs);
+            exit(-1);
+        }
+
+        sum = sum_sq = rows[i].evals = 0;
+        rows[i].t_min = INFINITY;
+        rows[i].reached = 1;
+        for (j = 0; j < reps && rows[i].reached; j++) {
+            status = run_ga(mpirun, filename, rows[i].n_procs,
+                rows[i].pop_size, target, cap, &t, &evals);
+            if (status < 0) rows[i].reached = 0;
+            else if (status == 0) {
+                fprintf(stderr, "Error: Run on %i processes failed\n",
+                    rows[i].n_procs);
+                exit(-1);
+            }
+            sum += t;
+            sum_sq += t*t;
+            if (t < rows[i].t_min) rows[i].t_min = t;
+            rows[i].evals += evals / reps;
+        }
+        rows[i].t_mean = sum / reps;
+        rows[i].t_std = sqrt(fmax(sum_sq / reps - pow(rows[i].t_mean, 2), 0));
+    }
+
+    // Speedup and efficiency are relative to the first process count
+    printf("%6s %9s %10s %10s %8s %8s %10s %12s\n", "np", "pop/deme",
+        "time (s)", "min (s)", "stddev", "speedup", "efficiency", "evals/s");
+    for (i = 0; i < n_nps; i++) {
+        if (!rows[i].reached) {
+            printf("%6i %9i %10s\n", rows[i].n_procs, rows[i].pop_size,
+                "not reached");
+            continue;
+        }
+        speedup = rows[0].reached ? rows[0].t_mean / rows[i].t_mean : NAN;
+        if (weak) eff = speedup;
+        else eff = speedup * rows[0].n_procs / rows[i].n_procs;
+        printf("%6i %9i %10.3f %10.3f %8.3f %8.2f %9.1f%% %12.0f\n",
+            rows[i].n_procs, rows[i].pop_size, rows[i].t_mean, rows[i].t_min,
+            rows[i].t_std, speedup, 100 * eff, rows[i].evals);
+    }
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Run ga once and read its profile                                           */
+/* mpirun        : The command used to launch MPI programs                    */
+/* n_procs       : The number of processes to run                             */
+/* pop_size      : The population size of each deme                           */
+/* target        : Fitness at which to end the run; NULL to run as configured */
+/* cap           : Seconds after which a run with a target is stopped         */
+/* elapsed       : Receives the elapsed time of the slowest process           */
+/* evals         : Receives the evaluations per second                        */
+/* return        : Positive if the run succeeded, negative if it was stopped  */
+/*                  before reaching its target, and 0 if it failed            */
+/* -------------------------------------------------------------------------- */
+int run_ga(char *mpirun, char *filename, int n_procs, int pop_size,
+        char *target, double cap, double *elapsed, double *evals) {
+    int fd, status, found = 0;
+    char prof_file[] = "/tmp/ga_scaling_XXXXXX";
+    char cmd[1024], line[256], *p;
+    FILE *fp;
+
+    fd = mkstemp(prof_file);
+    if (fd < 0) return 0;
+    close(fd);
+
+    // A run with a target has no other end, so it is stopped at the cap
+    cmd[0] = '\0';
+    if (target != NULL)
+        snprintf(cmd, sizeof(cmd), "%s %g ", SCALING_TIMEOUT, cap);
+    snprintf(cmd + strlen(cmd), sizeof(cmd) - strlen(cmd),
+        "%s -np %i ./ga -i %s -p pop_size=%i -t %s", mpirun, n_procs,
+        filename, pop_size, prof_file);
+    if (target != NULL)
+        snprintf(cmd + strlen(cmd), sizeof(cmd) - strlen(cmd),
+            " -p end_type=%i -p f_thresh=%s", M_MAX_FITNESS_THRESHHOLD,
+            target);
+    strncat(cmd, " > /dev/null 2>&1", sizeof(cmd) - strlen(cmd) - 1);
+    status = system(cmd);
+    if (status == -1) return 0;
+    if (target != NULL && WIFEXITED(status) && WEXITSTATUS(status) == 124) {
+        unlink(prof_file);
+        return -1;
+    }
+
+    // ga exits with status 1 on success, so check its profile instead
+    fp = fopen(prof_file, "r");
+    if (fp != NULL) {
+        while (fgets(line, sizeof(line), fp) != NULL) {
+            if ((p = strstr(line, "\"evals_per_sec\":")) != NULL)
+                found += sscanf(p, "\"evals_per_sec\": %lf", evals);
+            else if ((p = strstr(line, "\"elapsed\":")) != NULL)
+                found += sscanf(p, "\"elapsed\": {\"min\": %*f, \"mean\": %*f, "
+                    "\"max\": %lf", elapsed);
+        }
+        fclose(fp);
+    }
+    unlink(prof_file);
+    return found == 2;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Print a usage statement and exit the program                               */
+/* -------------------------------------------------------------------------- */
+void scaling_usage() {
+    printf("\n\nUsage: scaling [options] FILE NP...\n");
+    printf("Runs ga -i FILE on each number of processes NP.\n\n");
+    printf("Options:\n");
+    printf("\t-w: Weak scaling; each deme keeps the pop_size in FILE\n");
+    printf("\t-P TOTAL: Total population for strong scaling; defaults to\n");
+    printf("\t    pop_size in FILE times the first NP\n");
+    printf("\t-n REPS: Number of runs per NP (default %i)\n", SCALING_REPS);
+    printf("\t-f FITNESS: Run until a deme reaches FITNESS, and report\n");
+    printf("\t    the time to solution\n");
+    printf("\t-c SECONDS: Stop a run with -f that has not reached FITNESS\n");
+    printf("\t    after SECONDS (default %i)\n", SCALING_TIME_CAP);
+    printf("\t-m CMD: Command used to launch ga (default %s)\n\n",
+        SCALING_MPIRUN);
+    exit(-1);
+}
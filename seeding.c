@@ -0,0 +1,157 @@
+/* ========================================================================== */
+/* Heuristic seeding of shortest path populations. Random chromosomes decode  */
+/* to paths that zig-zag across the whole space, and many generations go to   */
+/* straightening them out. Instead, a seed_line fraction of the initial       */
+/* members may be seeded as the straight line from s to t with each waypoint  */
+/* jittered, and a seed_detour fraction as such a line bent around one of the */
+/* obstacles, with every waypoint pushed out of any obstacle it lies in. The  */
+/* remaining members stay random, keeping the population diverse.             */
+/* ========================================================================== */
+#include <math.h>
+#include "config.h"
+#include "fitness.h"
+#include "mt_mpi.h"
+#include "seeding.h"
+#include "types.h"
+
+
+/* -------------------------------------------------------------------------- */
+/* Seed the first members of a randomly initialized population with straight  */
+/* and detouring paths, encoded as make_path() decodes them                   */
+/* -------------------------------------------------------------------------- */
+void seed_population(deme *subpop) {
+    int i, n_line, n_detour;
+    point path[subpop->cfg.n_points+2];
+
+    if (subpop->ff_type != FF_SHPATH) return;
+    n_line = (int) lround(subpop->cfg.seed_line * subpop->pop_size);
+    n_detour = (int) lround(subpop->cfg.seed_detour * subpop->pop_size);
+    if (n_line + n_detour > subpop->pop_size)
+        n_detour = subpop->pop_size - n_line;
+
+    for (i = 0; i < n_line + n_detour; i++) {
+        line_path(subpop, path);
+        if (i >= n_line) detour_path(subpop, path);
+        encode_path(subpop, path, subpop->old_pop[i]->chr);
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Make a path with its waypoints spaced evenly along the line from s to t,   */
+/* each moved by up to seed_jitter in every coordinate                        */
+/* path          : Receives the path, including s and t                       */
+/* -------------------------------------------------------------------------- */
+void line_path(deme *subpop, point *path) {
+    int i, n = subpop->cfg.n_points, j = subpop->cfg.seed_jitter;
+    int bound = coord_bound(subpop);
+    double u;
+    point *s = subpop->s, *t = subpop->t;
+
+    pt_copy(&path[0], s);
+    pt_copy(&path[n+1], t);
+    for (i = 1; i < n+1; i++) {
+        u = (double) i / (n+1);
+        path[i].x = clamp_coord(s->x + (t->x - s->x)*u
+            + mt_rand_real(2*j, subpop->rng) - j, bound);
+        path[i].y = clamp_coord(s->y + (t->y - s->y)*u
+            + mt_rand_real(2*j, subpop->rng) - j, bound);
+        path[i].z = clamp_coord(s->z + (t->z - s->z)*u
+            + mt_rand_real(2*j, subpop->rng) - j, bound);
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Bend a path from s to t around an obstacle, preferably one that the line   */
+/* from s to t collides with. The waypoints near the obstacle are moved away  */
+/* from its center by one to two radii, tapering off along the path, and then */
+/* any waypoint inside an obstacle is pushed out to just beyond its surface.  */
+/* path          : The path to bend                                           */
+/* -------------------------------------------------------------------------- */
+void detour_path(deme *subpop, point *path) {
+    int i, k, c, n_hits = 0, n = subpop->cfg.n_points;
+    int bound = coord_bound(subpop);
+    int hits[subpop->n_objs > 0 ? subpop->n_objs : 1];
+    double st[3], away[3], len2, len, u, u0, width, amp, off;
+    point *s = subpop->s, *t = subpop->t, *center;
+    object *obj;
+
+    if (subpop->n_objs == 0) return;
+    for (k = 0; k < subpop->n_objs; k++)
+        if (collision(s, t, subpop->objs[k])) hits[n_hits++] = k;
+    if (n_hits > 0) obj = subpop->objs[hits[mt_rand_int(n_hits-1,
+        subpop->rng)]];
+    else obj = subpop->objs[mt_rand_int(subpop->n_objs-1, subpop->rng)];
+    center = obj->center;
+
+    // Find the point of the line nearest the obstacle's center, at a
+    // fraction u0 of the way from s to t
+    st[0] = t->x - s->x;
+    st[1] = t->y - s->y;
+    st[2] = t->z - s->z;
+    len2 = st[0]*st[0] + st[1]*st[1] + st[2]*st[2];
+    if (len2 == 0) return;
+    u0 = ((center->x - s->x)*st[0] + (center->y - s->y)*st[1]
+        + (center->z - s->z)*st[2]) / len2;
+    u0 = (u0 < 0) ? 0 : (u0 > 1) ? 1 : u0;
+
+    // Bend away from the center, in a random direction if the line passes
+    // through it
+    away[0] = s->x + st[0]*u0 - center->x;
+    away[1] = s->y + st[1]*u0 - center->y;
+    away[2] = s->z + st[2]*u0 - center->z;
+    for (c = 0; c < 3; c++)
+        away[c] += obj->radius * (mt_rand_real(1, subpop->rng) - 0.5);
+    len = sqrt(away[0]*away[0] + away[1]*away[1] + away[2]*away[2]);
+    if (len == 0) return;
+
+    amp = obj->radius * (1 + mt_rand_real(1, subpop->rng));
+    width = 2.0 * obj->radius / sqrt(len2) + 1.0 / (n+1);
+    for (i = 1; i < n+1; i++) {
+        u = (double) i / (n+1);
+        off = amp * exp(-(u - u0)*(u - u0) / (width*width)) / len;
+        path[i].x = clamp_coord(path[i].x + away[0]*off, bound);
+        path[i].y = clamp_coord(path[i].y + away[1]*off, bound);
+        path[i].z = clamp_coord(path[i].z + away[2]*off, bound);
+    }
+
+    for (i = 1; i < n+1; i++)
+        for (k = 0; k < subpop->n_objs; k++)
+            push_out(&path[i], subpop->objs[k], bound);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Fill a chromosome of the integer genome with random waypoints, spread      */
+/* uniformly over the space as random bits spread those of the binary genome  */
+/* -------------------------------------------------------------------------- */
+void random_path(deme *subpop, char *chr) {
+    int i, n = subpop->cfg.n_points, bound = coord_bound(subpop);
+    point path[n+2];
+
+    for (i = 1; i < n+1; i++) {
+        path[i].x = mt_rand_int(2*bound, subpop->rng) - bound;
+        path[i].y = mt_rand_int(2*bound, subpop->rng) - bound;
+        path[i].z = mt_rand_int(2*bound, subpop->rng) - bound;
+    }
+    encode_path(subpop, path, chr);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Move a waypoint that lies inside an obstacle radially out to SEED_MARGIN   */
+/* times the obstacle's radius from its center                                */
+/* -------------------------------------------------------------------------- */
+void push_out(point *p, object *obj, int bound) {
+    double dx = p->x - obj->center->x;
+    double dy = p->y - obj->center->y;
+    double dz = p->z - obj->center->z;
+    double dist = sqrt(dx*dx + dy*dy + dz*dz), scale;
+
+    if (dist >= obj->radius || dist == 0) return;
+    scale = SEED_MARGIN * obj->radius / dist;
+    p->x = clamp_coord(obj->center->x + dx*scale, bound);
+    p->y = clamp_coord(obj->center->y + dy*scale, bound);
+    p->z = clamp_coord(obj->center->z + dz*scale, bound);
+}
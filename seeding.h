@@ -0,0 +1,11 @@
+#ifndef SEEDING_H_
+#define SEEDING_H_
+#include "types.h"
+
+void    seed_population(deme*);
+void    line_path(deme*, point*);
+void    detour_path(deme*, point*);
+void    random_path(deme*, char*);
+void    push_out(point*, object*, int);
+
+#endif
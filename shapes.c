@@ -0,0 +1,463 @@
+/* ========================================================================== */
+/* Obstacle primitives besides spheres: axis-aligned boxes, capsules (the     */
+/* points within a radius of a line segment) and triangle meshes. Each kind   */
+/* is stored as a structure of arrays, one array of doubles per coordinate,   */
+/* so that a path segment is tested against every obstacle of a kind in one   */
+/* branch-free loop that the compiler vectorizes. Boxes and capsules are      */
+/* solid; a mesh is a surface, which a segment collides with if it crosses    */
+/* any of the mesh's triangles, and each mesh counts as one obstacle.         */
+/* ========================================================================== */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "config.h"
+#include "fitness.h"
+#include "shapes.h"
+#include "types.h"
+
+#define SHAPE_HUGE          1e300   // Inverse direction of an axis-parallel
+                                    // segment along the other axes
+#define SHAPE_EPS           1e-9    // Triangles nearer parallel are missed
+
+// Number of ints in a record of each kind
+static const int rec_size[SHAPE_KINDS] = {6, 7, 1, 9};
+
+
+/* -------------------------------------------------------------------------- */
+/* The obstacles of one scene besides its spheres                             */
+/* n            : Number of obstacles of each kind                            */
+/* recs         : The records the obstacles were made from, as read from a    */
+/*                  binary obstacle file, kept for sharing and exporting      */
+/* box          : Lower x, y, z, then upper x, y, z of each box               */
+/* cap          : End point x, y, z, axis x, y, z to the other end point,     */
+/*                  squared radius, squared length of the axis and its        */
+/*                  inverse (0 for a capsule of length 0) of each capsule     */
+/* mesh         : Lower x, y, z, then upper x, y, z of each mesh's bounds     */
+/* mesh_end     : Index of the triangle after each mesh's last triangle       */
+/* tri          : First vertex x, y, z, then edges x, y, z to the second and  */
+/*                  to the third vertex, of each triangle                     */
+/* data         : The block holding all coordinates                           */
+/* -------------------------------------------------------------------------- */
+struct shape_set {
+    int         n[SHAPE_KINDS];
+    int         *recs;
+    double      *box[6];
+    double      *cap[9];
+    double      *mesh[6];
+    int         *mesh_end;
+    double      *tri[9];
+    double      *data;
+};
+
+
+static inline double min2(double a, double b) { return (a < b) ? a : b; }
+static inline double max2(double a, double b) { return (a > b) ? a : b; }
+static inline double clamp01(double a) { return min2(max2(a, 0), 1); }
+
+
+/* -------------------------------------------------------------------------- */
+/* Find the number of ints in the records of a scene                          */
+/* n            : Number of obstacles of each kind                            */
+/* -------------------------------------------------------------------------- */
+int shape_ints(int *n) {
+    int k, size = 0;
+    for (k = 0; k < SHAPE_KINDS; k++) size += n[k] * rec_size[k];
+    return size;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Lay out the obstacles of a scene from their records                        */
+/* n            : Number of obstacles of each kind                            */
+/* recs         : The records of all boxes, then all capsules, then the sizes */
+/*                  of all meshes, then all triangles; owned by the scene     */
+/*                  from here on                                              */
+/* return       : The scene; NULL if it has no obstacles                      */
+/* -------------------------------------------------------------------------- */
+shape_set *shapes_create(int *n, int *recs) {
+    int i, c, m, t = 0;
+    int *r = recs, *v;
+    double *p;
+    shape_set *sh;
+
+    if (shape_ints(n) == 0) {
+        free(recs);
+        return NULL;
+    }
+    sh = (shape_set*) malloc(sizeof(shape_set));
+    for (c = 0; c < SHAPE_KINDS; c++) sh->n[c] = n[c];
+    sh->recs = recs;
+    sh->data = (double*) malloc(sizeof(double) * (6*n[SHAPE_BOXES]
+        + 9*n[SHAPE_CAPSULES] + 6*n[SHAPE_MESHES] + 9*n[SHAPE_TRIS]));
+    sh->mesh_end = (int*) malloc(sizeof(int) * (n[SHAPE_MESHES] + 1));
+
+    p = sh->data;
+    for (c = 0; c < 6; c++, p += n[SHAPE_BOXES])    sh->box[c] = p;
+    for (c = 0; c < 9; c++, p += n[SHAPE_CAPSULES]) sh->cap[c] = p;
+    for (c = 0; c < 6; c++, p += n[SHAPE_MESHES])   sh->mesh[c] = p;
+    for (c = 0; c < 9; c++, p += n[SHAPE_TRIS])     sh->tri[c] = p;
+
+    for (i = 0; i < n[SHAPE_BOXES]; i++, r += 6) {
+        for (c = 0; c < 3; c++) {
+            sh->box[c][i]   = min2(r[c], r[c+3]);
+            sh->box[c+3][i] = max2(r[c], r[c+3]);
+        }
+    }
+    for (i = 0; i < n[SHAPE_CAPSULES]; i++, r += 7) {
+        for (c = 0; c < 3; c++) {
+            sh->cap[c][i]   = r[c];
+            sh->cap[c+3][i] = r[c+3] - r[c];
+        }
+        sh->cap[6][i] = (double) r[6] * r[6];
+        sh->cap[7][i] = sh->cap[3][i]*sh->cap[3][i]
+            + sh->cap[4][i]*sh->cap[4][i] + sh->cap[5][i]*sh->cap[5][i];
+        sh->cap[8][i] = (sh->cap[7][i] > 0) ? 1 / sh->cap[7][i] : 0;
+    }
+
+    // Triangles are stored relative to their first vertex, and each mesh's
+    // bounds are found from its vertices
+    v = r + n[SHAPE_MESHES];
+    for (m = 0; m < n[SHAPE_MESHES]; m++) {
+        for (c = 0; c < 3; c++) {
+            sh->mesh[c][m] = SHAPE_HUGE;
+            sh->mesh[c+3][m] = -SHAPE_HUGE;
+        }
+        for (i = t; i < t + r[m] && i < n[SHAPE_TRIS]; i++, v += 9) {
+            for (c = 0; c < 3; c++) {
+                sh->tri[c][i]   = v[c];
+                sh->tri[c+3][i] = v[c+3] - v[c];
+                sh->tri[c+6][i] = v[c+6] - v[c];
+                sh->mesh[c][m] = min2(sh->mesh[c][m],
+                    min2(v[c], min2(v[c+3], v[c+6])));
+                sh->mesh[c+3][m] = max2(sh->mesh[c+3][m],
+                    max2(v[c], max2(v[c+3], v[c+6])));
+            }
+        }
+        t = i;
+        sh->mesh_end[m] = t;
+    }
+    return sh;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Release a scene made by shapes_create, if any                              */
+/* -------------------------------------------------------------------------- */
+void shapes_destroy(shape_set *sh) {
+    if (sh == NULL) return;
+    free(sh->recs);
+    free(sh->data);
+    free(sh->mesh_end);
+    free(sh);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Get the records a scene was made from                                      */
+/* n            : Receives the number of obstacles of each kind; all zero if  */
+/*                  sh is NULL                                                */
+/* return       : The records, owned by the scene                             */
+/* -------------------------------------------------------------------------- */
+int *shape_records(shape_set *sh, int *n) {
+    int c;
+    for (c = 0; c < SHAPE_KINDS; c++) n[c] = (sh != NULL) ? sh->n[c] : 0;
+    return (sh != NULL) ? sh->recs : NULL;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Test whether a segment passes through an axis-aligned box, by clipping the */
+/* segment's parameter range [0, 1] to each pair of the box's faces           */
+/* lx..hz       : The lower and upper corner of the box                       */
+/* a            : The start point of the segment                              */
+/* inv          : The inverse of the segment's direction along each axis      */
+/* -------------------------------------------------------------------------- */
+static inline int slab_hit(double lx, double ly, double lz, double hx,
+        double hy, double hz, const double *a, const double *inv) {
+    double t0, t1, lo = 0, hi = 1;
+
+    t0 = (lx - a[0]) * inv[0];      t1 = (hx - a[0]) * inv[0];
+    lo = max2(lo, min2(t0, t1));    hi = min2(hi, max2(t0, t1));
+    t0 = (ly - a[1]) * inv[1];      t1 = (hy - a[1]) * inv[1];
+    lo = max2(lo, min2(t0, t1));    hi = min2(hi, max2(t0, t1));
+    t0 = (lz - a[2]) * inv[2];      t1 = (hz - a[2]) * inv[2];
+    lo = max2(lo, min2(t0, t1));    hi = min2(hi, max2(t0, t1));
+    return lo <= hi;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Count the boxes a segment passes through. Like the other batch kernels,    */
+/* this counts in a double, which keeps the whole loop in double lanes.       */
+/* -------------------------------------------------------------------------- */
+static int box_hits(shape_set *sh, const double *a, const double *inv) {
+    int k, n = sh->n[SHAPE_BOXES];
+    double hits = 0;
+    double *lx = sh->box[0], *ly = sh->box[1], *lz = sh->box[2];
+    double *hx = sh->box[3], *hy = sh->box[4], *hz = sh->box[5];
+
+    #pragma omp simd reduction(+:hits)
+    for (k = 0; k < n; k++)
+        hits += slab_hit(lx[k], ly[k], lz[k], hx[k], hy[k], hz[k], a, inv)
+            ? 1.0 : 0.0;
+    return (int) hits;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Count the capsules of a range that a segment passes through. The closest   */
+/* points of the segment and each capsule's axis are found by clamping the    */
+/* closest points of the two lines to the segments, and the capsule is hit if */
+/* they are less than its radius apart.                                       */
+/* -------------------------------------------------------------------------- */
+static int capsule_hits(shape_set *sh, int first, int last, const double *a,
+        const double *d) {
+    int k;
+    double *px = sh->cap[0], *py = sh->cap[1], *pz = sh->cap[2];
+    double *ex = sh->cap[3], *ey = sh->cap[4], *ez = sh->cap[5];
+    double *r2 = sh->cap[6], *ee = sh->cap[7], *iee = sh->cap[8];
+    double dd = d[0]*d[0] + d[1]*d[1] + d[2]*d[2], idd, hits = 0;
+
+    // A segment of length 0 is a point, with every s the same
+    idd = (dd > 0) ? 1 / dd : 0;
+
+    #pragma omp simd reduction(+:hits)
+    for (k = first; k < last; k++) {
+        double rx = a[0] - px[k], ry = a[1] - py[k], rz = a[2] - pz[k];
+        double de = d[0]*ex[k] + d[1]*ey[k] + d[2]*ez[k];
+        double dr = d[0]*rx + d[1]*ry + d[2]*rz;
+        double er = ex[k]*rx + ey[k]*ry + ez[k]*rz;
+        double denom = dd*ee[k] - de*de;
+        double s, t, s0, s1, x, y, z;
+
+        // Both clamped choices of s are found, and the quotient with a safe
+        // divisor, so that the loop has no branches
+        s = clamp01((de*er - dr*ee[k]) / ((denom > 0) ? denom : 1));
+        s = (denom > 0) ? s : 0;
+        t = (de*s + er) * iee[k];
+        s0 = clamp01(-dr * idd);
+        s1 = clamp01((de - dr) * idd);
+        s = (t < 0) ? s0 : (t > 1) ? s1 : s;
+        s = (ee[k] > 0) ? s : s0;   // A capsule of length 0 is a sphere
+        t = clamp01(t);
+
+        x = rx + d[0]*s - ex[k]*t;
+        y = ry + d[1]*s - ey[k]*t;
+        z = rz + d[2]*s - ez[k]*t;
+        hits += (x*x + y*y + z*z < r2[k]) ? 1.0 : 0.0;
+    }
+    return (int) hits;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Test whether a segment crosses any triangle of a range, by solving for the */
+/* point of the segment in each triangle's plane in barycentric coordinates   */
+/* (Moller-Trumbore)                                                          */
+/* -------------------------------------------------------------------------- */
+static int tri_hits(shape_set *sh, int first, int last, const double *a,
+        const double *d) {
+    int k;
+    double hits = 0;
+    double *vx = sh->tri[0], *vy = sh->tri[1], *vz = sh->tri[2];
+    double *ux = sh->tri[3], *uy = sh->tri[4], *uz = sh->tri[5];
+    double *wx = sh->tri[6], *wy = sh->tri[7], *wz = sh->tri[8];
+
+    #pragma omp simd reduction(+:hits)
+    for (k = first; k < last; k++) {
+        double hx = d[1]*wz[k] - d[2]*wy[k];
+        double hy = d[2]*wx[k] - d[0]*wz[k];
+        double hz = d[0]*wy[k] - d[1]*wx[k];
+        double det = ux[k]*hx + uy[k]*hy + uz[k]*hz;
+        int ok = (det > SHAPE_EPS || det < -SHAPE_EPS);
+        double inv = 1 / (ok ? det : 1);
+        double sx = a[0] - vx[k], sy = a[1] - vy[k], sz = a[2] - vz[k];
+        double qx = sy*uz[k] - sz*uy[k];
+        double qy = sz*ux[k] - sx*uz[k];
+        double qz = sx*uy[k] - sy*ux[k];
+        double u = (sx*hx + sy*hy + sz*hz) * inv;
+        double v = (d[0]*qx + d[1]*qy + d[2]*qz) * inv;
+        double t = (wx[k]*qx + wy[k]*qy + wz[k]*qz) * inv;
+        hits += (ok && u >= 0 && v >= 0 && u + v <= 1 && t >= 0 && t <= 1)
+            ? 1.0 : 0.0;
+    }
+    return (int) hits;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Count the meshes a segment crosses, skipping those whose bounds it misses  */
+/* -------------------------------------------------------------------------- */
+static int mesh_hits(shape_set *sh, const double *a, const double *d,
+        const double *inv) {
+    int m, first = 0, hits = 0;
+    double **b = sh->mesh;
+
+    for (m = 0; m < sh->n[SHAPE_MESHES]; first = sh->mesh_end[m++]) {
+        if (slab_hit(b[0][m], b[1][m], b[2][m], b[3][m], b[4][m], b[5][m],
+                a, inv))
+            hits += (tri_hits(sh, first, sh->mesh_end[m], a, d) > 0);
+    }
+    return hits;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Count the obstacles of a scene that a path segment collides with           */
+/* sh           : The scene; may be NULL                                      */
+/* A, B         : The end points of the segment                               */
+/* -------------------------------------------------------------------------- */
+int shape_hits(shape_set *sh, point *A, point *B) {
+    int c;
+    double a[3], d[3], inv[3];
+
+    if (sh == NULL) return 0;
+    a[0] = A->x;    d[0] = B->x - A->x;
+    a[1] = A->y;    d[1] = B->y - A->y;
+    a[2] = A->z;    d[2] = B->z - A->z;
+    for (c = 0; c < 3; c++) inv[c] = (d[c] != 0) ? 1 / d[c] : SHAPE_HUGE;
+
+    return box_hits(sh, a, inv) + capsule_hits(sh, 0, sh->n[SHAPE_CAPSULES],
+        a, d) + mesh_hits(sh, a, d, inv);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Find the squared distance between two segments, as a scalar reference for  */
+/* capsule_hits (Ericson, Real-Time Collision Detection, 5.1.9)               */
+/* a, d         : The start point and direction of the first segment          */
+/* p, e         : The start point and direction of the second segment         */
+/* -------------------------------------------------------------------------- */
+static double segment_dist2(const double *a, const double *d, const double *p,
+        const double *e) {
+    int c;
+    double r[3], v, dist2 = 0;
+    double dd = 0, ee = 0, de = 0, dr = 0, er = 0, s = 0, t = 0;
+
+    for (c = 0; c < 3; c++) {
+        r[c] = a[c] - p[c];
+        dd += d[c]*d[c];
+        ee += e[c]*e[c];
+        de += d[c]*e[c];
+        dr += d[c]*r[c];
+        er += e[c]*r[c];
+    }
+    if (dd > 0 && ee > 0) {
+        if (dd*ee - de*de > 0) s = clamp01((de*er - dr*ee) / (dd*ee - de*de));
+        t = (de*s + er) / ee;
+        if (t < 0) {
+            t = 0;
+            s = clamp01(-dr / dd);
+        }
+        else if (t > 1) {
+            t = 1;
+            s = clamp01((de - dr) / dd);
+        }
+    }
+    else if (dd > 0) s = clamp01(-dr / dd);
+    else if (ee > 0) t = clamp01(er / ee);
+
+    for (c = 0; c < 3; c++) {
+        v = r[c] + d[c]*s - e[c]*t;
+        dist2 += v*v;
+    }
+    return dist2;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Check capsule_hits on one capsule against segment_dist2, for the segment   */
+/* from the start point to the end point and for probes of length 4 radii     */
+/* along each axis, centered on each end point of the capsule and 2 radii off */
+/* it. Probes that graze the capsule, within rounding, are not checked.       */
+/* i            : The index of the capsule                                    */
+/* r            : Its record                                                  */
+/* return       : 1 if the kernel and the reference disagree; 0 otherwise     */
+/* -------------------------------------------------------------------------- */
+static int check_capsule(deme *subpop, int i, int *r) {
+    int c, j, m, hit;
+    double a[3], d[3], p[3], e[3], r2 = (double) r[6] * r[6], dist2;
+
+    for (c = 0; c < 3; c++) {
+        p[c] = r[c];
+        e[c] = r[c+3] - r[c];
+    }
+    a[0] = subpop->s->x;    d[0] = subpop->t->x - a[0];
+    a[1] = subpop->s->y;    d[1] = subpop->t->y - a[1];
+    a[2] = subpop->s->z;    d[2] = subpop->t->z - a[2];
+
+    for (j = -1; j < 12; j++) {
+        // Probe j runs along axis j%3 through end point j/6, offset by 2
+        // radii along the next axis for j/3 odd
+        if (j >= 0) for (c = 0; c < 3; c++) {
+            a[c] = r[3*(j/6) + c];
+            if (c == j%3)                     a[c] -= 2.0 * r[6];
+            if (c == (j+1)%3 && (j/3) % 2)    a[c] += 2.0 * r[6];
+            d[c] = (c == j%3) ? 4.0 * r[6] : 0;
+        }
+        dist2 = segment_dist2(a, d, p, e);
+        if (fabs(dist2 - r2) <= SHAPE_EPS * r2) continue;
+        hit = capsule_hits(subpop->shapes, i, i+1, a, d);
+        m = (dist2 < r2);
+        if (hit != m) return 1;
+    }
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Check the obstacles of a shortest path run besides its spheres: each must  */
+/* lie within the space, and neither the start nor the end point may lie in   */
+/* a box or capsule. The collision kernel of each capsule is also checked     */
+/* against a scalar reference.                                                */
+/* return       : 1 if any are invalid; 0 otherwise                           */
+/* -------------------------------------------------------------------------- */
+int test_shapes(deme *subpop) {
+    int i, j, k, n[SHAPE_KINDS], size = 0, is_invalid = 0;
+    int *r = shape_records(subpop->shapes, n);
+    char *names[SHAPE_KINDS] = {"box", "capsule", "mesh", "triangle"};
+    point p;
+
+    for (k = 0; k < SHAPE_KINDS; k++) {
+        for (i = 0; i < n[k]; i++, r += rec_size[k]) {
+            if (k == SHAPE_MESHES) {
+                size += r[0];
+                if (r[0] >= 1) continue;
+                fprintf(stderr, "Error: Invalid mesh %i\n", i);
+                is_invalid = 1;
+                continue;
+            }
+            for (j = 0; j + 3 <= rec_size[k]; j += 3) {
+                p.x = r[j];
+                p.y = r[j+1];
+                p.z = r[j+2];
+                if (!valid_loc(&p)) break;
+            }
+            if (j + 3 <= rec_size[k] || (k == SHAPE_CAPSULES && r[6] < 1)) {
+                fprintf(stderr, "Error: Invalid %s %i\n", names[k], i);
+                is_invalid = 1;
+            }
+            else if (k == SHAPE_CAPSULES && check_capsule(subpop, i, r)) {
+                fprintf(stderr, "Error: Collision test of capsule %i does "
+                    "not match the reference\n", i);
+                is_invalid = 1;
+            }
+        }
+    }
+    if (size != n[SHAPE_TRIS]) {
+        fprintf(stderr, "Error: Meshes hold %i triangles, not %i\n", size,
+            n[SHAPE_TRIS]);
+        is_invalid = 1;
+    }
+
+    // Segments of length 0 are points, which only solid obstacles contain
+    if (shape_hits(subpop->shapes, subpop->s, subpop->s) > 0) {
+        fprintf(stderr, "Error: An obstacle overlaps the start point\n");
+        is_invalid = 1;
+    }
+    if (shape_hits(subpop->shapes, subpop->t, subpop->t) > 0) {
+        fprintf(stderr, "Error: An obstacle overlaps the end point\n");
+        is_invalid = 1;
+    }
+    return is_invalid;
+}
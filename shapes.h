@@ -0,0 +1,19 @@
+#ifndef SHAPES_H_
+#define SHAPES_H_
+#include "types.h"
+
+// Kinds of obstacle records in a binary obstacle file, in file order
+#define SHAPE_BOXES         0       // x0, y0, z0, x1, y1, z1
+#define SHAPE_CAPSULES      1       // x0, y0, z0, x1, y1, z1, radius
+#define SHAPE_MESHES        2       // Number of triangles
+#define SHAPE_TRIS          3       // x0, y0, z0, x1, y1, z1, x2, y2, z2
+#define SHAPE_KINDS         4
+
+shape_set   *shapes_create(int*, int*);
+void        shapes_destroy(shape_set*);
+int         shape_ints(int*);
+int         *shape_records(shape_set*, int*);
+int         shape_hits(shape_set*, point*, point*);
+int         test_shapes(deme*);
+
+#endif
@@ -0,0 +1,127 @@
+/* ========================================================================== */
+/* Binary population snapshots, used to warm-start a run from the population  */
+/* at the end of a previous one. All processes write their members to one     */
+/* file with MPI-IO; when loading, each process maps the file and reads only  */
+/* its own slice of it.                                                       */
+/* ========================================================================== */
+#include <fcntl.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "fitness.h"
+#include "multires.h"
+#include "snapshot.h"
+#include "types.h"
+
+
+/* -------------------------------------------------------------------------- */
+/* Write the current members of all sub-populations to a snapshot file. Each  */
+/* process's members follow those of the processes before it.                 */
+/* filename      : The snapshot file to write                                 */
+/* -------------------------------------------------------------------------- */
+void write_snapshot(deme *subpop, char *filename) {
+    int i, my_rank, n_procs;
+    int n_bytes = (subpop->chr_size + 7) / 8;
+    double fitness[subpop->pop_size];
+    unsigned char *packed = (unsigned char*) malloc(subpop->pop_size*n_bytes);
+    MPI_Offset fit_start, chr_start;
+    snap_header hdr;
+    MPI_File fh;
+    my_rank = subpop->rank;
+    MPI_Comm_size(subpop->comm, &n_procs);
+
+    for (i = 0; i < subpop->pop_size; i++) {
+        fitness[i] = subpop->new_pop[i]->fitness;
+        pack_chr(subpop->new_pop[i]->chr, subpop->chr_size, packed+i*n_bytes);
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = SNAP_MAGIC;
+    hdr.ff_type = subpop->ff_type;
+    hdr.chr_size = subpop->chr_size;
+    hdr.n_bytes = n_bytes;
+    hdr.n_members = n_procs * subpop->pop_size;
+    fit_start = sizeof(hdr) + (MPI_Offset) my_rank*subpop->pop_size
+        * sizeof(double);
+    chr_start = sizeof(hdr) + (MPI_Offset) hdr.n_members*sizeof(double)
+        + (MPI_Offset) my_rank*subpop->pop_size*n_bytes;
+
+    MPI_File_open(subpop->comm, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+        MPI_INFO_NULL, &fh);
+    if (my_rank == 0)
+        MPI_File_write_at(fh, 0, &hdr, sizeof(hdr), MPI_CHAR,
+            MPI_STATUS_IGNORE);
+    MPI_File_write_at_all(fh, fit_start, fitness, subpop->pop_size,
+        MPI_DOUBLE, MPI_STATUS_IGNORE);
+    MPI_File_write_at_all(fh, chr_start, packed, subpop->pop_size*n_bytes,
+        MPI_CHAR, MPI_STATUS_IGNORE);
+    MPI_File_close(&fh);
+
+    free(packed);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Replace the members of the starting population with this process's slice   */
+/* of a snapshot. Each process takes the pop_size members following those of  */
+/* the processes before it; if the snapshot holds fewer members than the run, */
+/* the remaining members are left as they are. The snapshot may come from a   */
+/* run with a different number of processes or population size, and, in a     */
+/* multi-resolution run, at any of its resolutions.                           */
+/* filename      : The snapshot file to read                                  */
+/* return        : The number of members loaded; negative if the file could   */
+/*                  not be read or does not match this run                    */
+/* -------------------------------------------------------------------------- */
+int load_snapshot(deme *subpop, char *filename) {
+    int i, fd, my_rank, first, count;
+    struct stat st;
+    snap_header *hdr;
+    unsigned char *chrs;
+    void *map;
+    my_rank = subpop->rank;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < sizeof(snap_header)) {
+        fprintf(stderr, "Error: Could not read snapshot %s\n", filename);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    // Pages outside this process's slice are never touched, so never read
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Error: Could not map snapshot %s\n", filename);
+        return -1;
+    }
+
+    hdr = (snap_header*) map;
+    if (hdr->magic != SNAP_MAGIC || hdr->ff_type != subpop->ff_type
+        || !set_resolution(subpop, hdr->chr_size)
+        || st.st_size < sizeof(snap_header) + (off_t) hdr->n_members
+            * (sizeof(double) + hdr->n_bytes)) {
+        fprintf(stderr, "Error: Snapshot %s does not match this run\n",
+            filename);
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    first = my_rank * subpop->pop_size;
+    count = hdr->n_members - first;
+    if (count > subpop->pop_size) count = subpop->pop_size;
+    if (count < 0) count = 0;
+
+    chrs = (unsigned char*) map + sizeof(snap_header)
+        + (size_t) hdr->n_members*sizeof(double);
+    for (i = 0; i < count; i++)
+        unpack_chr(chrs + (size_t) (first+i)*hdr->n_bytes, subpop->chr_size,
+            subpop->old_pop[i]->chr);
+
+    munmap(map, st.st_size);
+    return count;
+}
+
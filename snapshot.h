@@ -0,0 +1,26 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+#include "types.h"
+
+#define SNAP_MAGIC          0x47415053  // "GAPS"
+
+
+/* -------------------------------------------------------------------------- */
+/* Header of a population snapshot file. It is followed by the fitness of     */
+/* every member as an array of n_members doubles, then by every member's      */
+/* chromosome packed into n_bytes bytes, in the same order.                   */
+/* -------------------------------------------------------------------------- */
+typedef struct {
+    int         magic;
+    int         ff_type;
+    int         chr_size;
+    int         n_bytes;
+    int         n_members;
+    int         reserved[3];
+} snap_header;
+
+void    write_snapshot(deme*, char*);
+int     load_snapshot(deme*, char*);
+
+#endif
+
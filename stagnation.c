@@ -0,0 +1,93 @@
+/* ========================================================================== */
+/* Restart of stagnant demes. A deme whose best fitness has not improved by   */
+/* RESTART_IMPROVE for restart_gens generations has converged on members      */
+/* that are no longer worth evolving; it keeps its restart_elite most fit     */
+/* members, replaces all others with random ones, and carries on, while the   */
+/* other demes of the run are unaffected. Migration then mixes the new        */
+/* members with those of the neighboring demes.                               */
+/* ========================================================================== */
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "config.h"
+#include "fitness.h"
+#include "ga.h"
+#include "mt_mpi.h"
+#include "seeding.h"
+#include "stagnation.h"
+#include "types.h"
+
+
+/* -------------------------------------------------------------------------- */
+/* Track the best fitness of this deme, and restart it once it has not        */
+/* improved for restart_gens generations                                      */
+/* -------------------------------------------------------------------------- */
+void check_stagnation(deme *subpop) {
+    double best = subpop->old_pop[subpop->fit_max]->fitness;
+
+    if (subpop->cfg.restart_gens == 0) return;
+    if (best > subpop->stag_best * (1 + RESTART_IMPROVE)) {
+        subpop->stag_best = best;
+        subpop->stag_gens = 0;
+        return;
+    }
+    if (++subpop->stag_gens >= subpop->cfg.restart_gens) restart_deme(subpop);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Keep the restart_elite most fit members of this deme, randomize all other  */
+/* members and evaluate them. fit_novar is left as is, so that a run ending   */
+/* on local convergence still ends.                                           */
+/* -------------------------------------------------------------------------- */
+void restart_deme(deme *subpop) {
+    int i, j, n = subpop->cfg.restart_elite;
+    int top[n > 0 ? n : 1];
+    char *elite = (char*) calloc(subpop->pop_size, 1);
+    org **pop;
+
+    fittest_members(subpop, n, top, elite);
+
+    for (i = 0; i < subpop->pop_size; i++) {
+        if (elite[i]) continue;
+        if (subpop->cfg.genome == GENOME_INT)
+            random_path(subpop, subpop->old_pop[i]->chr);
+        else for (j = 0; j < subpop->chr_size; j++)
+            subpop->old_pop[i]->chr[j] = mt_rand_bit(subpop->rng);
+    }
+    free(elite);
+
+    // The kernels only move fit_max and fit_min to better and worse members,
+    // and the members they pointed to may have been replaced
+    fitness(subpop);
+    pop = subpop->old_pop;
+    for (i = 0; i < subpop->pop_size; i++) {
+        if (pop[i]->fitness > pop[subpop->fit_max]->fitness)
+            subpop->fit_max = i;
+        if (pop[i]->fitness < pop[subpop->fit_min]->fitness)
+            subpop->fit_min = i;
+    }
+
+    subpop->stag_best = subpop->old_pop[subpop->fit_max]->fitness;
+    subpop->stag_gens = 0;
+    subpop->n_restarts++;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Print the number of restarts of all demes. Must be called by all           */
+/* processes.                                                                 */
+/* -------------------------------------------------------------------------- */
+void restart_report(deme *subpop) {
+    int local = subpop->n_restarts, total, min, max, n_procs;
+
+    if (subpop->cfg.restart_gens == 0) return;
+    MPI_Comm_size(subpop->comm, &n_procs);
+    MPI_Reduce(&local, &total, 1, MPI_INT, MPI_SUM, 0, subpop->comm);
+    MPI_Reduce(&local, &min, 1, MPI_INT, MPI_MIN, 0, subpop->comm);
+    MPI_Reduce(&local, &max, 1, MPI_INT, MPI_MAX, 0, subpop->comm);
+
+    if (subpop->rank == 0)
+        printf("Restarts: %i; per deme: %i min, %.1f mean, %i max\n", total,
+            min, (double) total / n_procs, max);
+}
@@ -0,0 +1,9 @@
+#ifndef STAGNATION_H_
+#define STAGNATION_H_
+#include "types.h"
+
+void    check_stagnation(deme*);
+void    restart_deme(deme*);
+void    restart_report(deme*);
+
+#endif
@@ -0,0 +1,306 @@
+/* ========================================================================== */
+/* Surrogate pre-screening of offspring. An archive of recently evaluated     */
+/* members is kept with their chromosomes packed into bits, and the fitness   */
+/* of each offspring is predicted as the mean fitness of its surr_k nearest   */
+/* archived members by Hamming distance, found with XOR and popcount over     */
+/* the packed words. Only the surr_frac of offspring with the best predicted  */
+/* fitness are evaluated; the others keep their predicted fitness, unless it  */
+/* would make them the most fit member. The evaluated offspring are then      */
+/* added to the archive, replacing the oldest.                                */
+/* ========================================================================== */
+#include <math.h>
+#include <mpi.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "fitness.h"
+#include "surrogate.h"
+#include "types.h"
+
+
+/* -------------------------------------------------------------------------- */
+/* The surrogate model of one population                                      */
+/* n_words      : Number of 64-bit words per packed chromosome                */
+/* chr_size     : Chromosome size of the archived members; the archive is     */
+/*                  cleared when a multi-resolution run changes it            */
+/* words        : Packed chromosomes of the archive, n_words per member       */
+/* fit          : Fitness of each archived member                             */
+/* count        : Number of members in the archive                            */
+/* next         : Index of the next archive entry to replace                  */
+/* pred         : Predicted fitness of each offspring of this generation      */
+/* packed       : Packed chromosome of each offspring of this generation      */
+/* n_pred       : Number of offspring given a predicted fitness               */
+/* n_checked    : Number of predictions compared with a true evaluation       */
+/* err_sum      : Sum of the relative errors of the checked predictions       */
+/* -------------------------------------------------------------------------- */
+struct surrogate {
+    int         n_words;
+    int         chr_size;
+    uint64_t    *words;
+    double      *fit;
+    int         count;
+    int         next;
+    double      *pred;
+    uint64_t    *packed;
+    double      n_pred;
+    double      n_checked;
+    double      err_sum;
+};
+
+
+/* -------------------------------------------------------------------------- */
+/* Set up the surrogate model of a population, if surr_frac is below 1        */
+/* -------------------------------------------------------------------------- */
+void surrogate_open(deme *subpop) {
+    surrogate *sm;
+    if (subpop->cfg.surr_frac >= 1) return;
+
+    sm = (surrogate*) malloc(sizeof(surrogate));
+    sm->n_words = (subpop->chr_max + 63) / 64;
+    sm->chr_size = subpop->chr_size;
+    sm->words = (uint64_t*) malloc(sizeof(uint64_t) * sm->n_words
+        * SURR_ARCHIVE);
+    sm->fit = (double*) malloc(sizeof(double) * SURR_ARCHIVE);
+    sm->count = 0;
+    sm->next = 0;
+    sm->pred = (double*) malloc(sizeof(double) * subpop->pop_size);
+    sm->packed = (uint64_t*) malloc(sizeof(uint64_t) * sm->n_words
+        * subpop->pop_size);
+    sm->n_pred = 0;
+    sm->n_checked = 0;
+    sm->err_sum = 0;
+
+    subpop->skip = (char*) calloc(subpop->pop_size, 1);
+    subpop->n_skip = 0;
+    subpop->surr = sm;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Release the surrogate model of a population, if any                        */
+/* -------------------------------------------------------------------------- */
+void surrogate_close(deme *subpop) {
+    surrogate *sm = subpop->surr;
+    if (sm == NULL) return;
+
+    free(sm->words);
+    free(sm->fit);
+    free(sm->pred);
+    free(sm->packed);
+    free(sm);
+    free(subpop->skip);
+    subpop->surr = NULL;
+    subpop->skip = NULL;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Predict the fitness of each offspring and flag all but the most promising  */
+/* surr_frac of them to be skipped by the next evaluation. Nothing is skipped */
+/* until the archive is full.                                                 */
+/* -------------------------------------------------------------------------- */
+void screen(deme *subpop) {
+    int i, j, best, n_eval;
+    surrogate *sm = subpop->surr;
+    uint64_t *packed;
+
+    if (sm == NULL) return;
+    if (sm->chr_size != subpop->chr_size) {
+        sm->chr_size = subpop->chr_size;
+        sm->count = 0;
+        sm->next = 0;
+    }
+
+    for (i = 0; i < subpop->pop_size; i++) {
+        packed = &sm->packed[i*sm->n_words];
+        memset(packed, 0, sizeof(uint64_t) * sm->n_words);
+        pack_chr(subpop->new_pop[i]->chr, subpop->chr_size,
+            (unsigned char*) packed);
+        if (sm->count == SURR_ARCHIVE) sm->pred[i] = predict(sm, packed,
+            subpop->cfg.surr_k);
+    }
+    if (sm->count < SURR_ARCHIVE) return;
+
+    // Evaluate the offspring with the best predictions, keeping ties in
+    // population order, and skip the rest
+    n_eval = (int) ceil(subpop->cfg.surr_frac * subpop->pop_size);
+    memset(subpop->skip, 1, subpop->pop_size);
+    for (i = 0; i < n_eval; i++) {
+        best = -1;
+        for (j = 0; j < subpop->pop_size; j++) {
+            if (subpop->skip[j] && (best < 0 || sm->pred[j] > sm->pred[best]))
+                best = j;
+        }
+        subpop->skip[best] = 0;
+    }
+    for (i = 0; i < subpop->pop_size; i++)
+        if (subpop->skip[i]) subpop->new_pop[i]->fitness = sm->pred[i];
+    subpop->n_skip = subpop->pop_size - n_eval;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Predict the fitness of a packed chromosome from its nearest neighbors in   */
+/* the archive                                                                */
+/* sm            : The surrogate model, with a full archive                   */
+/* packed        : The packed chromosome                                      */
+/* k             : The number of neighbors to average                         */
+/* return        : The mean fitness of the k nearest archived members         */
+/* -------------------------------------------------------------------------- */
+double predict(surrogate *sm, uint64_t *packed, int k) {
+    int i, j, w, d;
+    int dist[k];
+    double fit[k], sum = 0;
+    uint64_t *words;
+
+    for (j = 0; j < k; j++) dist[j] = INT32_MAX;
+    for (i = 0; i < sm->count; i++) {
+        words = &sm->words[i*sm->n_words];
+        for (d = 0, w = 0; w < sm->n_words; w++)
+            d += __builtin_popcountll(packed[w] ^ words[w]);
+        if (d >= dist[k-1]) continue;
+
+        // Insert into the list of nearest neighbors, sorted by distance
+        for (j = k-1; j > 0 && dist[j-1] > d; j--) {
+            dist[j] = dist[j-1];
+            fit[j] = fit[j-1];
+        }
+        dist[j] = d;
+        fit[j] = sm->fit[i];
+    }
+
+    for (j = 0; j < k; j++) sum += fit[j];
+    return sum / k;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* After an evaluation, check the predictions of the evaluated offspring and  */
+/* add them to the archive, then clear the skip flags                         */
+/* -------------------------------------------------------------------------- */
+void train_surrogate(deme *subpop) {
+    int i, full;
+    surrogate *sm = subpop->surr;
+    double fit;
+
+    if (sm == NULL) return;
+    full = (sm->count == SURR_ARCHIVE);
+    for (i = 0; i < subpop->pop_size; i++) {
+        if (subpop->skip[i]) continue;
+        fit = subpop->new_pop[i]->fitness;
+        if (full && fit > 0) {
+            sm->err_sum += fabs(sm->pred[i] - fit) / fit;
+            sm->n_checked++;
+        }
+
+        memcpy(&sm->words[sm->next*sm->n_words], &sm->packed[i*sm->n_words],
+            sizeof(uint64_t) * sm->n_words);
+        sm->fit[sm->next] = fit;
+        sm->next = (sm->next + 1) % SURR_ARCHIVE;
+        if (sm->count < SURR_ARCHIVE) sm->count++;
+    }
+
+    sm->n_pred += subpop->n_skip;
+    memset(subpop->skip, 0, subpop->pop_size);
+    subpop->n_skip = 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Find the size in bytes of the state of a population's surrogate model in a */
+/* checkpoint: its archive, with room for SURR_ARCHIVE members, and counters  */
+/* return        : The size; 0 if the surrogate is disabled                   */
+/* -------------------------------------------------------------------------- */
+int surrogate_size(deme *subpop) {
+    surrogate *sm = subpop->surr;
+    if (sm == NULL) return 0;
+    return 3*sizeof(int) + 3*sizeof(double)
+        + SURR_ARCHIVE*(sm->n_words*sizeof(uint64_t) + sizeof(double));
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Pack the state of a population's surrogate model into a checkpoint record  */
+/* p             : Where to pack it; must hold surrogate_size() bytes         */
+/* return        : The end of the packed state                                */
+/* -------------------------------------------------------------------------- */
+char *save_surrogate(deme *subpop, char *p) {
+    surrogate *sm = subpop->surr;
+    int ints[3];
+    double sums[3];
+    if (sm == NULL) return p;
+
+    ints[0] = sm->chr_size;
+    ints[1] = sm->count;
+    ints[2] = sm->next;
+    sums[0] = sm->n_pred;
+    sums[1] = sm->n_checked;
+    sums[2] = sm->err_sum;
+    memcpy(p, ints, sizeof(ints));
+    p += sizeof(ints);
+    memcpy(p, sums, sizeof(sums));
+    p += sizeof(sums);
+    memcpy(p, sm->words, SURR_ARCHIVE*sm->n_words*sizeof(uint64_t));
+    p += SURR_ARCHIVE*sm->n_words*sizeof(uint64_t);
+    memcpy(p, sm->fit, SURR_ARCHIVE*sizeof(double));
+    return p + SURR_ARCHIVE*sizeof(double);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Restore the state of a population's surrogate model from a checkpoint      */
+/* record written by save_surrogate()                                         */
+/* p             : The packed state                                           */
+/* return        : The end of the packed state                                */
+/* -------------------------------------------------------------------------- */
+char *load_surrogate(deme *subpop, char *p) {
+    surrogate *sm = subpop->surr;
+    int ints[3];
+    double sums[3];
+    if (sm == NULL) return p;
+
+    memcpy(ints, p, sizeof(ints));
+    p += sizeof(ints);
+    memcpy(sums, p, sizeof(sums));
+    p += sizeof(sums);
+    sm->chr_size = ints[0];
+    sm->count = ints[1];
+    sm->next = ints[2];
+    sm->n_pred = sums[0];
+    sm->n_checked = sums[1];
+    sm->err_sum = sums[2];
+    memcpy(sm->words, p, SURR_ARCHIVE*sm->n_words*sizeof(uint64_t));
+    p += SURR_ARCHIVE*sm->n_words*sizeof(uint64_t);
+    memcpy(sm->fit, p, SURR_ARCHIVE*sizeof(double));
+    return p + SURR_ARCHIVE*sizeof(double);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/* Print the fraction of evaluations skipped by all processes, and the mean   */
+/* relative error of the predictions that were checked by an evaluation       */
+/* -------------------------------------------------------------------------- */
+void surrogate_report(deme *subpop) {
+    int my_rank;
+    surrogate *sm = subpop->surr;
+    double local[4], total[4];
+
+    if (sm == NULL) return;
+    my_rank = subpop->rank;
+    local[0] = sm->n_pred;
+    local[1] = subpop->n_evals;
+    local[2] = sm->n_checked;
+    local[3] = sm->err_sum;
+    MPI_Reduce(local, total, 4, MPI_DOUBLE, MPI_SUM, 0, subpop->comm);
+
+    if (my_rank == 0) {
+        printf("Surrogate: %.1f%% of evaluations skipped; ",
+            100 * total[0] / (total[0] + total[1]));
+        if (total[2] > 0)
+            printf("mean error %.2f%% over %.0f checked predictions\n",
+                100 * total[3] / total[2], total[2]);
+        else printf("no predictions checked\n");
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef SURROGATE_H_
+#define SURROGATE_H_
+#include <stdint.h>
+#include "types.h"
+
+void    surrogate_open(deme*);
+void    surrogate_close(deme*);
+void    screen(deme*);
+double  predict(surrogate*, uint64_t*, int);
+void    train_surrogate(deme*);
+void    surrogate_report(deme*);
+int     surrogate_size(deme*);
+char    *save_surrogate(deme*, char*);
+char    *load_surrogate(deme*, char*);
+
+#endif
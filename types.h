@@ -1,5 +1,7 @@
 #ifndef TYPES_H_
 #define TYPES_H_
+#include <mpi.h>
+#include "config.h"
 
 
 /* -------------------------------------------------------------------------- */
@@ -13,13 +15,16 @@ typedef struct {
 
 
 /* -------------------------------------------------------------------------- */
-/* A structure representing a 3-dimensional object, approximated by a sphere  */
+/* A structure representing a 3-dimensional object, approximated by a sphere. */
+/* Other kinds of obstacles are kept apart, in a shape_set.                   */
 /* center        : The center of the sphere                                   */
 /* radius        : The radius of the sphere                                   */
+/* missing       : Set if the input gave no center; only used to validate it  */
 /* -------------------------------------------------------------------------- */
 typedef struct {
     point    *center;
     int        radius;
+    int        missing;
 } object;
 
 
@@ -38,12 +43,159 @@ typedef struct {
 } org;
 
 
+/* -------------------------------------------------------------------------- */
+/* A struct describing a ring of neighboring sub-populations for migration.   */
+/* comm         : The communicator the ring is laid out over; MPI_COMM_NULL   */
+/*                  if this process does not take part in the ring            */
+/* left         : The rank (in comm) of the left neighbor                     */
+/* right        : The rank (in comm) of the right neighbor                    */
+/* left_box     : The left neighbor's migrant outbox, if it shares this       */
+/*                  node's memory; NULL otherwise                             */
+/* right_box    : The right neighbor's migrant outbox, if it shares this      */
+/*                  node's memory; NULL otherwise                             */
+/* shm_sync     : Non-zero if any member of this node reads an outbox, so all */
+/*                  node members must synchronize before each exchange        */
+/* -------------------------------------------------------------------------- */
+typedef struct {
+    MPI_Comm    comm;
+    int         left;
+    int         right;
+    char        *left_box;
+    char        *right_box;
+    int         shm_sync;
+} ring;
+
+
+/* -------------------------------------------------------------------------- */
+/* Tunable GA settings, which default to the values in config.h and may be    */
+/* overridden by the parameter file or the command line.                      */
+/* xover_rate   : Probability that a pair of parents is crossed over          */
+/* mut_rate     : Probability that a chromosome (segment) is mutated          */
+/* selection    : Parent selection operator: SEL_ROULETTE or SEL_TOURNAMENT   */
+/* tourn_size   : Number of members drawn for each tournament                 */
+/* crossover    : Crossover operator: XO_MIDPOINT, XO_ONE_POINT or XO_UNIFORM */
+/* n_points     : Number of waypoints of a shortest path; with a multi-       */
+/*                  resolution schedule, the current number of waypoints,     */
+/*                  which grows up to the configured value                    */
+/* n_points_start : Number of waypoints at the start of a multi-resolution    */
+/*                  schedule; 0 to use n_points throughout                    */
+/* res_gens     : Generations between checks of whether to subdivide paths    */
+/* coord_size   : Number of bits per waypoint coordinate, including the sign  */
+/* coll_cost    : Cost added to a path's length for each collision            */
+/* genome       : Encoding of shortest paths: GENOME_BINARY for sign-         */
+/*                  magnitude bit strings, GENOME_INT for arrays of ints      */
+/* mut_sigma    : Standard deviation of the mutation of integer coordinates   */
+/* ls_top       : Number of most fit members refined by local search after    */
+/*                  each evaluation; 0 to disable                             */
+/* ls_probes    : Maximum number of moves tried per refined member            */
+/* ls_step      : Initial distance a waypoint coordinate is moved             */
+/* seed_line    : Fraction of initial paths seeded as jittered straight lines */
+/* seed_detour  : Fraction of initial paths seeded as lines bent around an    */
+/*                  obstacle                                                  */
+/* seed_jitter  : Maximum distance a seeded waypoint coordinate is jittered   */
+/* surr_frac    : Fraction of offspring evaluated after surrogate screening;  */
+/*                  1 to evaluate all offspring                               */
+/* surr_k       : Number of nearest neighbors averaged by the surrogate       */
+/* restart_gens : Generations without improvement after which a deme is       */
+/*                  restarted; 0 to disable                                   */
+/* restart_elite : Number of most fit members kept by a restart               */
+/* fused        : Non-zero to breed and evaluate offspring in one pass        */
+/* numa_alloc   : Non-zero to place population and obstacle buffers on the    */
+/*                  NUMA node of each process                                 */
+/* huge_pages   : Huge pages backing placed buffers: 0 for none, 1 for        */
+/*                  transparent and 2 for explicit huge pages                 */
+/* prnt_*       : Reporting options; see PRNT_* in config.h                   */
+/* targets      : Fitness levels at which to record the time to solution      */
+/* n_targets    : Number of targets                                           */
+/* -------------------------------------------------------------------------- */
+typedef struct {
+    double      xover_rate;
+    double      mut_rate;
+    int         selection;
+    int         tourn_size;
+    int         crossover;
+    int         n_points;
+    int         n_points_start;
+    int         res_gens;
+    int         coord_size;
+    double      coll_cost;
+    int         genome;
+    double      mut_sigma;
+    int         ls_top;
+    int         ls_probes;
+    int         ls_step;
+    double      seed_line;
+    double      seed_detour;
+    int         seed_jitter;
+    double      surr_frac;
+    int         surr_k;
+    int         restart_gens;
+    int         restart_elite;
+    int         fused;
+    int         numa_alloc;
+    int         huge_pages;
+    int         prnt_rate;
+    int         prnt_data;
+    int         prnt_stat;
+    int         prnt_chrs;
+    int         prnt_info;
+    int         prnt_fits;
+    double      targets[MAX_TARGETS];
+    int         n_targets;
+} settings;
+
+
+/* -------------------------------------------------------------------------- */
+/* A binary run log, as defined in runlog.c                                   */
+/* -------------------------------------------------------------------------- */
+typedef struct runlog runlog;
+
+
+/* -------------------------------------------------------------------------- */
+/* Per-phase timers and counters, as defined in profile.h                     */
+/* -------------------------------------------------------------------------- */
+typedef struct profile profile;
+
+
+/* -------------------------------------------------------------------------- */
+/* A surrogate fitness model, as defined in surrogate.c                       */
+/* -------------------------------------------------------------------------- */
+typedef struct surrogate surrogate;
+
+
+/* -------------------------------------------------------------------------- */
+/* The state of a random number stream, as defined in mt_mpi.h                */
+/* -------------------------------------------------------------------------- */
+typedef struct mt_state mt_state;
+
+
+/* -------------------------------------------------------------------------- */
+/* The placed memory buffers of a deme, as defined in placement.c             */
+/* -------------------------------------------------------------------------- */
+typedef struct placement placement;
+
+
+/* -------------------------------------------------------------------------- */
+/* The boxes, capsules and meshes of a scene, as defined in shapes.c          */
+/* -------------------------------------------------------------------------- */
+typedef struct shape_set shape_set;
+
+
 /* -------------------------------------------------------------------------- */
 /* A struct representing a (sub)population.                                   */
+/* comm         : Communicator of the processes of this run; MPI_COMM_WORLD,  */
+/*                  or the communicator of a group of processes in batch mode */
+/* rank         : The rank of this process in comm                            */
+/* rng          : The random number stream of this process                    */
 /* old_pop      : The members of the current generation                       */
 /* new_pop      : The members of the new generation being generated           */
 /* rand_seed    : The seed used to initialize the random number generator     */
 /* chr_size     : The size of the chromosomes in this population              */
+/* chr_max      : The largest chromosome size of the run, which storage is    */
+/*                  allocated for; chr_size grows up to it with a multi-      */
+/*                  resolution schedule                                       */
+/* res_best     : The best fitness of all populations at the last check of    */
+/*                  the multi-resolution schedule                             */
 /* fit_tot      : The total fitness of this population                        */
 /* fit_avg      : The average fitness of this population                      */
 /* fit_max      : The index of the most fit member of this population         */
@@ -51,6 +203,10 @@ typedef struct {
 /* fit_prev     : The average fitness of the previous generation              */
 /* fit_novar    : The number consecutive generations for which this           */
 /*                  population's fit_avg has varied by less than conv_var     */
+/* stag_best    : The best fitness of this population when it last improved   */
+/*                  by RESTART_IMPROVE                                        */
+/* stag_gens    : The number of generations since stag_best was set           */
+/* n_restarts   : The number of times this population has been restarted      */
 /* cur_gen      : The current generation                                      */
 /* pop_size     : The size of this population                                 */
 /* ff_type      : The fitness function to use                                 */
@@ -63,25 +219,87 @@ typedef struct {
 /*                  if end type is M_LOCAL_CONVERGENCE; if the average fitness*/
 /*                  varies by less than conv_var for conv_gens generations,   */
 /*                  the algorithm has converged on a local min/max            */
+/* time_limit   : Wall-clock budget of the run in seconds, if end type is     */
+/*                  M_WALL_CLOCK                                              */
+/* run_start    : Time at which the run started                               */
+/* next_check   : Generation at which the time left is next checked           */
+/* last_check   : Time since run_start at the last check                      */
+/* last_gen     : Generation of the last check                                */
 /* complete     : A non-zero value flags this population as terminated        */
+/* cfg          : Tunable GA settings                                         */
+/* islands      : Settings of individual islands, as island_* entries in the  */
+/*                  parameter file format; NULL if there are none             */
+/* fit_kernel   : The fitness function, specialized for cfg at startup        */
+/* fused_kernel : The fused offspring pipeline, specialized likewise          */
+/* n_evals      : Number of fitness evaluations by this process               */
+/* skip         : Flags the members whose fitness was predicted by the        */
+/*                  surrogate, which the next evaluation skips; NULL if the   */
+/*                  surrogate is disabled                                     */
+/* n_skip       : Number of members flagged in skip                           */
+/* surr         : The surrogate fitness model; NULL if disabled               */
+/* start_time   : Time at which the main loop started; for a resumed run, as  */
+/*                  if it had started before the checkpointed generations     */
+/* prior_time   : Main loop time of the run this one resumed, at its          */
+/*                  checkpoint; 0 if not resumed                              */
+/* tgt_gen      : Generation at which the best member of this population      */
+/*                  first reached each target; -1 if not reached              */
+/* tgt_time     : Time since start_time at which each target was reached      */
+/*                                                                            */
+/* Migration and memory layout:                                               */
+/* chr_pool     : Contiguous storage for the chromosomes of old_pop and       */
+/*                  new_pop; allocated in a node-local shared memory window   */
+/*                  when SHM_MIGRATION is enabled                             */
+/* outbox       : Two alternating slots of (least fit, most fit) chromosomes  */
+/*                  published to node-local neighbors at each migration       */
+/* shm_epoch    : The outbox slot used by the next migration                  */
+/* node_comm    : Communicator of the processes sharing this node's memory    */
+/* leader_comm  : Communicator of the first process on each node; this is     */
+/*                  MPI_COMM_NULL on all other processes                      */
+/* shm_win      : The shared memory window holding outbox and chr_pool        */
+/* place        : The buffers placed on this process's NUMA node; NULL unless */
+/*                  numa_alloc is set                                         */
+/* mig_ring     : The ring of all processes, used for flat migration          */
+/* node_ring    : The ring of processes on this node, used for HIER_MIGRATION */
+/* leader_ring  : The ring of node leaders, used for HIER_MIGRATION           */
+/*                                                                            */
+/* Checkpointing:                                                             */
+/* ckpt_file    : File to write checkpoints to; NULL if disabled              */
+/* ckpt_rate    : Number of generations between checkpoints                   */
+/* ckpt_buf     : Staging buffer of the checkpoint being written, if any      */
+/* ckpt_fh      : The checkpoint file being written                           */
+/* ckpt_req     : The request of the checkpoint write in progress             */
+/* log          : Binary run log that reports are written to; NULL to print   */
+/*                  reports to stdout                                         */
+/* snap_file    : File to write a population snapshot to at the end of the    */
+/*                  run; NULL if disabled                                     */
+/* prof         : Per-phase timers and counters; NULL if disabled             */
 /*                                                                            */
 /* If the shortest path fitness function is being used:                       */
 /* n_objs       : The number of obstacles                                     */
 /* objs         : The set of obstacles                                        */
+/* shapes       : The obstacles other than spheres; NULL if there are none    */
 /* s            : Start point                                                 */
 /* t            : End point                                                   */
 /* -------------------------------------------------------------------------- */
-typedef struct {
+typedef struct deme {
+    MPI_Comm    comm;
+    int         rank;
+    mt_state    *rng;
     org         **old_pop;
     org         **new_pop;
     int         rand_seed;
     int         chr_size;
+    int         chr_max;
+    double      res_best;
     double      fit_tot;
     double      fit_avg;
     int         fit_max;
     int         fit_min;
     int         fit_prev;
     int         fit_novar;
+    double      stag_best;
+    int         stag_gens;
+    int         n_restarts;
     int         cur_gen;
     int         pop_size;
     int         ff_type;
@@ -90,9 +308,45 @@ typedef struct {
     double      f_thresh;
     int         conv_gen;
     double      conv_var;
+    double      time_limit;
+    double      run_start;
+    int         next_check;
+    double      last_check;
+    int         last_gen;
     int         complete;
+    settings    cfg;
+    char        *islands;
+    void        (*fit_kernel)(struct deme*);
+    void        (*fused_kernel)(struct deme*);
+    double      n_evals;
+    char        *skip;
+    int         n_skip;
+    surrogate   *surr;
+    double      start_time;
+    double      prior_time;
+    int         tgt_gen[MAX_TARGETS];
+    double      tgt_time[MAX_TARGETS];
+    char        *chr_pool;
+    char        *outbox;
+    int         shm_epoch;
+    MPI_Comm    node_comm;
+    MPI_Comm    leader_comm;
+    MPI_Win     shm_win;
+    placement   *place;
+    ring        mig_ring;
+    ring        node_ring;
+    ring        leader_ring;
+    char        *ckpt_file;
+    int         ckpt_rate;
+    char        *ckpt_buf;
+    MPI_File    ckpt_fh;
+    MPI_Request ckpt_req;
+    runlog      *log;
+    char        *snap_file;
+    profile     *prof;
     int         n_objs;
     object      **objs;
+    shape_set   *shapes;
     point       *s;
     point       *t;
 } deme;